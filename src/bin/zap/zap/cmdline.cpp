@@ -11,6 +11,10 @@
 #include <zap/commands/configure.hpp>
 #include <zap/commands/build.hpp>
 #include <zap/commands/install.hpp>
+#include <zap/commands/fetch.hpp>
+#include <zap/commands/sync.hpp>
+#include <zap/commands/mirror.hpp>
+#include <zap/commands/uninstall.hpp>
 #include <zap/commands/analyze.hpp>
 #include <zap/log.hpp>
 
@@ -29,6 +33,10 @@ Commands:
     env          Manage environments
     remote       Manage remotes
     install      Install software
+    fetch        Download software archives
+    sync         Reconcile environment with Zapfile
+    mirror       Manage archive mirrors
+    uninstall    Uninstall software
     configure    Configures project
     analyze      Shows project targets and interfaces
 
@@ -42,8 +50,12 @@ R"(usage:
     zap env delete <name>
     zap env ls [<name>]
     zap env lspkgs [<name>]
+    zap env which <file> [<name>]
 
 Manages environments.
+
+'which' shows the package installing a file, given relative to the
+environment root, as an absolute path or as an #include path.
 )";
 
 static const char remote_usage[] =
@@ -57,24 +69,126 @@ Manages remotes.
 
 static const char install_usage[] =
 R"(usage:
-    zap install [-e <env>] <url> [--] [<args>...]
+    zap install [-e <env>] [--fresh] [--digest <digest>] <url> [--] [<args>...]
     zap install [-e <env>] -d <directory> [--] [<args>...]
-    zap install [-e <env>] -f <file>
+    zap install [-e <env>] [--fresh] [--prefetch <count>] -f <file>
+    zap install [-e <env>] [--fresh] [--prefetch <count>] [-z <zapfile>]
 
 Options:
-    -e <env>        Environment to use
-    -d <directory>  Installs software from extracted archive in <directory>
-    -f <file>       Installs software from list in <file>
+    -e <env>            Environment to use
+    -d <directory>      Installs software from extracted archive in <directory>
+    -f <file>           Installs software from list in <file>
+    -z <zapfile>        Installs dependencies of <zapfile> [default: Zapfile]
+    --fresh             Builds from scratch instead of reusing build trees
+    --digest <digest>   Expected archive digest (sha256:<hex>, blake3:<hex>)
+    --prefetch <count>  Concurrent downloads of a list [default: 4]
 
 The first form allows you to install a software package by specifying a URL.
 All subsequent arguments will be forwarded to the package build system.
+Git repositories are given as git+<repo>#<ref>, where <ref> is a tag, a
+branch or a commit id; they are fetched incrementally into a bare mirror
+shared by all environments (~/.cache/zap/git).
+
+An archive pinned with --digest is verified while it downloads and the
+download fails if it doesn't match. Matching archives skip the archive
+integrity test before extraction.
+
+Build trees of downloaded packages are kept in the environment work
+directory, so reinstalling a package with different arguments only rebuilds
+what changed. The least recently used ones are removed when they grow past
+ZAP_WORK_MAX_SIZE (20G by default).
 
 The second form will install software listed in the specified file where
-each line is in the first form, that is:
+each line is in the first form, with an optional digest, that is:
 
-URL1 [ARGS...]
-URL2 [ARGS...]
+URL1 [DIGEST1] [ARGS...]
+URL2 [DIGEST2] [ARGS...]
 ...
+
+All archives of the list are downloaded and extracted in the background
+while the first packages build.
+
+The last form installs the dependencies of a Zapfile and records their
+URLs, archive digests, build systems and options in <zapfile>.lock. As long
+as the Zapfile doesn't change, the next installs use the lock as is: no
+remote resolution, no conditional requests, and archives must match their
+locked digests.
+)";
+
+static const char fetch_usage[] =
+R"(usage:
+    zap fetch [-e <env>] [-j <count>] <url>...
+    zap fetch [-e <env>] [-j <count>] -f <file>
+
+Options:
+    -e <env>        Environment to use
+    -f <file>       Fetches software from list in <file>, as for install
+    -j <count>      Concurrent downloads [default: 4]
+
+Downloads archives to the environment archive store without building
+them, e.g. to bake them into CI images.
+)";
+
+static const char sync_usage[] =
+R"(usage:
+    zap sync [-e <env>] [-n] [-j <count>] [--prefetch <count>] [<zapfile>]
+
+Options:
+    -e <env>            Environment to use
+    -n                  Only shows what would be done
+    -j <count>          Concurrent builds [default: 2]
+    --prefetch <count>  Concurrent downloads [default: 4]
+
+Installs, upgrades and rebuilds the dependencies of <zapfile> (Zapfile by
+default) so that the environment matches it, and uninstalls the ones it
+previously installed that were removed from it.
+
+A dependency is rebuilt when its archive, its options or one of the
+dependencies it requires changed. Requirements are listed in the
+dependency options, e.g.:
+
+depends:
+  - fmtlib/fmt@10.0.0
+  - gabime/spdlog@v1.12.0:
+      requires: [ fmt ]
+      configure: [ -DSPDLOG_FMT_EXTERNAL=ON ]
+
+Dependents only stale because a requirement changed are not rebuilt when
+the new shared libraries of the requirement are ABI compatible with the
+old ones: same SONAME and only exported symbols added. The verdict and the
+changed symbols are printed.
+
+Dependencies build in waves, the ones of a wave in parallel, each wave
+after the ones it requires. Resolution is recorded in <zapfile>.lock, as
+for install, so that syncing an up to date environment only reads the lock
+and the environment database.
+)";
+
+static const char mirror_usage[] =
+R"(usage:
+    zap mirror sync [-e <env>] [-j <count>] [-f <file>] <directory>
+
+Options:
+    -e <env>        Environment to use
+    -f <file>       Mirrors software from list in <file>, as for install
+    -j <count>      Concurrent downloads [default: 4]
+
+'sync' adds the archives of the Zapfile dependencies (or of a list) to a
+mirror directory, which can be served over HTTP or used as is.
+
+Mirrors are tried in order before upstream URLs when listed in
+ZAP_MIRRORS, separated by spaces, as directories, file:// roots or
+HTTP(S) base URLs.
+)";
+
+static const char uninstall_usage[] =
+R"(usage:
+    zap uninstall [-e <env>] <pkg>...
+
+Options:
+    -e <env>        Environment to use
+
+Removes the files installed by packages from the environment.
 )";
 
 static const char configure_usage[] =
@@ -89,13 +203,29 @@ Configures a project to build with CMake.
 
 static const char analyze_usage[] =
 R"(usage:
-    zap analyze [-e <env>] <directory>
+    zap analyze [-e <env>] [--top <count>] <directory>
+    zap analyze [-e <env>] [--top <count>] [--json <file>] --build-time <build-dir> <directory>
+    zap analyze [-e <env>] [--top <count>] [--json <file>] --critical-path <build-dir> <directory>
 
 Options:
-    -e <env>     Environment to use
-    <directory>  Project directory to analyze
-
-Configures a project to build with CMake.
+    -e <env>                  Environment to use
+    --top <count>             Number of costliest entries to show [default: 20]
+    --build-time <build-dir>  Report build times from compiler traces
+    --critical-path <build-dir>
+                              Report the critical path of the last build
+    --json <file>             Also write the report as JSON
+    <directory>               Project directory to analyze
+
+Scans project targets and reports on their dependencies and header
+compile costs.
+
+With --build-time, aggregates the -ftime-trace files written by clang
+(<object>.json) or the -ftime-report output of gcc captured in
+<object>.ftime-report files found in <build-dir>.
+
+With --critical-path, combines the step times of the last Ninja build with
+its dependency graph and reports the longest path, per target serial time
+and the best speedup achievable at various core counts.
 )";
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -213,6 +343,9 @@ parse_env(cmdline& cl, const zap::strings& cmd_args)
         opts.cmd = zap::commands::env_cmd::ls_env;
     } else if (args["lspkgs"].asBool()) {
         opts.cmd = zap::commands::env_cmd::ls_pkgs;
+    } else if (args["which"].asBool()) {
+        opts.cmd = zap::commands::env_cmd::which;
+        set_opt(args, "<file>", opts.file);
     }
 
     set_opt(args, "<name>", opts.name);
@@ -258,10 +391,81 @@ parse_install(cmdline& cl, const zap::strings& cmd_args)
     set_opt(args, "<args>", opts.args);
     set_opt(args, "-d", opts.directory);
     set_opt(args, "-f", opts.file);
+    set_opt(args, "--fresh", opts.fresh);
+    set_opt(args, "--digest", opts.digest);
+    set_opt(args, "-z", opts.zapfile);
+    set_opt(args, "--prefetch", opts.prefetch);
 
     cl.cp = new_command<zap::commands::install>(cl.env(), opts);
 }
 
+void
+parse_fetch(cmdline& cl, const zap::strings& cmd_args)
+{
+    auto args = docopt::docopt(fetch_usage, cmd_args, true);
+
+    set_env(cl, args, "-e");
+
+    zap::commands::fetch_opts opts;
+
+    set_opt(args, "<url>", opts.urls);
+    set_opt(args, "-f", opts.file);
+    set_opt(args, "-j", opts.jobs);
+
+    cl.cp = new_command<zap::commands::fetch>(cl.env(), opts);
+}
+
+void
+parse_sync(cmdline& cl, const zap::strings& cmd_args)
+{
+    auto args = docopt::docopt(sync_usage, cmd_args, true);
+
+    set_env(cl, args, "-e");
+
+    zap::commands::sync_opts opts;
+
+    set_opt(args, "<zapfile>", opts.zapfile);
+    set_opt(args, "-n", opts.dry_run);
+    set_opt(args, "-j", opts.jobs);
+    set_opt(args, "--prefetch", opts.prefetch);
+
+    cl.cp = new_command<zap::commands::sync>(cl.env(), opts);
+}
+
+void
+parse_mirror(cmdline& cl, const zap::strings& cmd_args)
+{
+    auto args = docopt::docopt(mirror_usage, cmd_args, true);
+
+    set_env(cl, args, "-e");
+
+    zap::commands::mirror_opts opts;
+
+    if (args["sync"].asBool()) {
+        opts.cmd = zap::commands::mirror_cmd::sync;
+    }
+
+    set_opt(args, "<directory>", opts.directory);
+    set_opt(args, "-f", opts.file);
+    set_opt(args, "-j", opts.jobs);
+
+    cl.cp = new_command<zap::commands::mirror>(cl.env(), opts);
+}
+
+void
+parse_uninstall(cmdline& cl, const zap::strings& cmd_args)
+{
+    auto args = docopt::docopt(uninstall_usage, cmd_args, true);
+
+    set_env(cl, args, "-e");
+
+    zap::commands::uninstall_opts opts;
+
+    set_opt(args, "<pkg>", opts.pkgs);
+
+    cl.cp = new_command<zap::commands::uninstall>(cl.env(), opts);
+}
+
 void
 parse_configure(cmdline& cl, const zap::strings& cmd_args)
 {
@@ -284,6 +488,10 @@ parse_analyze(cmdline& cl, const zap::strings& cmd_args)
     zap::commands::analyze_opts opts;
 
     set_opt(args, "<directory>", opts.directory);
+    set_opt(args, "--top", opts.top);
+    set_opt(args, "--build-time", opts.build_dir);
+    set_opt(args, "--critical-path", opts.ninja_dir);
+    set_opt(args, "--json", opts.json_file);
 
     cl.cp = new_command<zap::commands::analyze>(cl.env(), opts);
 }
@@ -295,6 +503,10 @@ parse_map parsers = {
     { "env", &parse_env },
     { "remote", &parse_remote },
     { "install", &parse_install },
+    { "fetch", &parse_fetch },
+    { "sync", &parse_sync },
+    { "mirror", &parse_mirror },
+    { "uninstall", &parse_uninstall },
     { "configure", &parse_configure },
     { "analyze", &parse_analyze }
 };
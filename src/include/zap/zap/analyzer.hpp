@@ -0,0 +1,30 @@
+#pragma once
+
+#include <ostream>
+
+#include <zap/env.hpp>
+#include <zap/project.hpp>
+
+namespace zap {
+
+class analyzer
+{
+public:
+    analyzer(
+        const zap::env& e,
+        const project& p
+    );
+    virtual ~analyzer();
+
+    const zap::env& env() const;
+    const project& p() const;
+
+    virtual void analyze() = 0;
+    virtual void print(std::ostream& os) const = 0;
+
+private:
+    const zap::env& e_;
+    const project& p_;
+};
+
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <zap/analyzer.hpp>
+
+namespace zap::analyzers {
+
+struct build_time_entry
+{
+    std::string name;
+    // Total time, in microseconds
+    std::uint64_t usecs = 0;
+    std::size_t count = 0;
+
+    std::size_t millisecs() const;
+    std::size_t avg_millisecs() const;
+};
+
+using build_time_entries = std::vector<build_time_entry>;
+using build_time_map = std::unordered_map<std::string, build_time_entry>;
+
+struct build_time_context
+{
+    build_time_map files;
+    build_time_map headers;
+    build_time_map templates;
+    build_time_map functions;
+    build_time_map passes;
+
+    void merge(build_time_context& other);
+};
+
+// Build time from compiler traces found in a build directory
+//
+// Reads the per translation unit -ftime-trace JSON files written by clang
+// (<object>.json) and the -ftime-report output of gcc, captured from its
+// standard error in <object>.ftime-report files. Times are summed over the
+// whole project and files are attributed to project targets.
+//
+// Header and template times are inclusive: nested includes and
+// instantiations are also counted in their parents.
+class build_time : public zap::analyzer
+{
+public:
+    build_time(
+        const zap::env& e,
+        const zap::project& p,
+        const std::string& build_dir,
+        std::size_t top = 20
+    );
+
+    virtual ~build_time();
+
+    void analyze() final;
+    void print(std::ostream& os) const final;
+
+    // Full report, not limited to the top entries
+    void write_json(const std::string& file) const;
+
+    // All sorted by decreasing time
+    const build_time_entries& targets() const;
+    const build_time_entries& files() const;
+    const build_time_entries& headers() const;
+    const build_time_entries& templates() const;
+    const build_time_entries& functions() const;
+    const build_time_entries& passes() const;
+
+private:
+    void add_sources(const zap::targets& ts);
+
+    void parse_file(build_time_context& ctx, const std::string& file) const;
+
+    void parse_time_trace(
+        build_time_context& ctx,
+        const std::string& file,
+        const std::string& tu
+    ) const;
+
+    void parse_time_report(
+        build_time_context& ctx,
+        const std::string& file,
+        const std::string& tu
+    ) const;
+
+    std::string source_of(const std::string& stem) const;
+    std::string relative(const std::string& path) const;
+
+    void attribute(const build_time_map& files);
+
+    void print(
+        std::ostream& os,
+        const std::string& title,
+        const build_time_entries& entries
+    ) const;
+
+    std::string build_dir_;
+    std::size_t top_;
+    // Project source -> owning target
+    zap::string_map source_targets_;
+    build_time_entries targets_;
+    build_time_entries files_;
+    build_time_entries headers_;
+    build_time_entries templates_;
+    build_time_entries functions_;
+    build_time_entries passes_;
+};
+
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <zap/analyzer.hpp>
+#include <zap/csr_graph.hpp>
+#include <zap/prog.hpp>
+
+namespace zap::analyzers {
+
+// One build step (edge output) from .ninja_log, times in milliseconds
+struct ninja_step
+{
+    std::string output;
+    std::size_t start = 0;
+    std::size_t end = 0;
+    std::string hash;
+
+    std::size_t duration() const;
+};
+
+using ninja_steps = std::vector<ninja_step>;
+
+struct target_time
+{
+    std::string name;
+    std::size_t steps = 0;
+    // Sum of step durations
+    std::size_t serial = 0;
+    // Sum of step durations on the critical path
+    std::size_t critical = 0;
+};
+
+using target_times = std::vector<target_time>;
+
+struct core_estimate
+{
+    std::size_t cores = 0;
+    // Lower bound of the build time on that many cores
+    std::size_t time = 0;
+    double speedup = 0;
+};
+
+using core_estimates = std::vector<core_estimate>;
+
+// Critical path of the last Ninja build of a build directory
+//
+// Step durations come from .ninja_log, dependencies between steps from
+// the build manifest (ninja -t graph) and discovered header dependencies
+// on generated files (ninja -t deps). The build can't be faster than its
+// longest dependency chain (span) however many cores are thrown at it,
+// so the speedup at N cores is bounded by work / max(work / N, span).
+class critical_path : public zap::analyzer
+{
+public:
+    critical_path(
+        const zap::env& e,
+        const zap::project& p,
+        const std::string& build_dir,
+        std::size_t top = 20
+    );
+
+    virtual ~critical_path();
+
+    void analyze() final;
+    void print(std::ostream& os) const final;
+
+    void write_json(const std::string& file) const;
+
+    // Longest path, first step to build first
+    const ninja_steps& path() const;
+
+    // Sorted by decreasing serial time
+    const target_times& targets() const;
+
+    const core_estimates& estimates() const;
+
+    // Sum of all step durations
+    std::size_t work() const;
+
+    // Length of the critical path
+    std::size_t span() const;
+
+    // Wall clock time of the build
+    std::size_t wall() const;
+
+private:
+    void read_log();
+    void read_graph();
+    void read_deps();
+
+    void compute();
+    void estimate();
+
+    std::string target_of(const std::string& output) const;
+
+    std::string build_dir_;
+    std::size_t top_;
+    zap::prog ninja_;
+    // Output -> step of the last build
+    std::unordered_map<std::string, ninja_step> steps_;
+    zap::csr_graph g_;
+    ninja_steps path_;
+    target_times targets_;
+    core_estimates estimates_;
+    std::size_t work_ = 0;
+    std::size_t span_ = 0;
+    std::size_t wall_ = 0;
+};
+
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <zap/analyzer.hpp>
+#include <zap/csr_graph.hpp>
+
+namespace zap::analyzers {
+
+struct header_cost
+{
+    std::string header;
+    // Bytes of the header itself
+    std::size_t size = 0;
+    // Bytes of the header and everything it includes, transitively
+    std::size_t pp_size = 0;
+    // Number of translation units including it, transitively
+    std::size_t fan_in = 0;
+
+    std::size_t cost() const;
+};
+
+using header_costs = std::vector<header_cost>;
+
+struct tu_cost
+{
+    std::string file;
+    std::size_t headers = 0;
+    std::size_t bytes = 0;
+};
+
+using tu_costs = std::vector<tu_cost>;
+
+// Compile cost of headers from scanned include dependencies
+//
+// Transitive closures of the include graph are computed with one bit set
+// per header, the costliest headers are those included by many
+// translation units while pulling in many bytes.
+class headers : public zap::analyzer
+{
+public:
+    headers(
+        const zap::env& e,
+        const zap::project& p,
+        std::size_t top = 20
+    );
+
+    virtual ~headers();
+
+    void analyze() final;
+    void print(std::ostream& os) const final;
+
+    // Sorted by decreasing cost
+    const header_costs& hdrs() const;
+
+    // Sorted by decreasing included bytes
+    const tu_costs& tus() const;
+
+private:
+    void add_targets(const zap::targets& ts);
+    void add_target(const zap::target& t);
+
+    std::string resolve(
+        const zap::target& t,
+        const std::string& name
+    ) const;
+
+    std::size_t file_size(const std::string& path) const;
+
+    void compute();
+
+    std::size_t top_;
+    zap::csr_graph g_;
+    std::vector<bool> is_tu_;
+    header_costs hdrs_;
+    tu_costs tus_;
+};
+
+}
@@ -13,6 +13,10 @@ struct archive_info
     std::string temp_dir;
     std::string name;
     std::string version;
+    // sha256:<hex> digest of file, whatever the pinned algorithm
+    std::string digest;
+    // file matched a pinned digest
+    bool verified = false;
 };
 
 }
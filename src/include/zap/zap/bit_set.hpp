@@ -0,0 +1,54 @@
+#pragma once
+
+#include <bit>
+#include <cstdint>
+#include <vector>
+
+namespace zap {
+
+// Dynamically sized bit set, used for transitive closures over graphs
+class bit_set
+{
+public:
+    bit_set(std::size_t size = 0);
+    virtual ~bit_set();
+
+    void resize(std::size_t size);
+    void clear();
+
+    std::size_t size() const;
+    std::size_t count() const;
+    bool none() const;
+
+    void set(std::size_t i);
+    void reset(std::size_t i);
+    bool test(std::size_t i) const;
+
+    bit_set& operator|=(const bit_set& other);
+
+    // Calls cb(index) for each set bit, in increasing order
+    template <typename Callable>
+    void for_each(Callable&& cb) const
+    {
+        for (std::size_t w = 0; w < words_.size(); ++w) {
+            auto word = words_[w];
+
+            while (word != 0) {
+                auto bit = std::countr_zero(word);
+
+                cb(w * word_bits + bit);
+                word &= word - 1;
+            }
+        }
+    }
+
+private:
+    using word_type = std::uint64_t;
+
+    static constexpr std::size_t word_bits = 64;
+
+    std::vector<word_type> words_;
+    std::size_t size_ = 0;
+};
+
+}
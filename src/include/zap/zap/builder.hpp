@@ -36,19 +36,27 @@ using builder_ptr = std::unique_ptr<builder_base>;
 class builder
 {
 public:
+    // Detects the build system unless given a type
     builder(
         const zap::env& e,
         const archive_info& ai,
-        const strings& args = {}
+        const strings& args = {},
+        const std::string& type = {}
     );
 
     virtual ~builder();
 
+    // Build system of a source directory (cmake, autotools)
+    static std::string detect(const std::string& source_dir);
+
+    const std::string& type() const;
+
     void configure() const;
     void build() const;
     void install(zap::package::manifest& pm) const;
 
 private:
+    std::string type_;
     builder_ptr bp_;
 };
 
@@ -21,9 +21,13 @@ public:
     void install(zap::package::manifest& pm) const final;
 
 private:
+    void prepare_cache() const;
+
     zap::prog make_;
     std::string build_dir_;
     std::string stage_dir_;
+    // config.cache shared by packages built with the same toolchain
+    std::string cache_file_;
 };
 
 }
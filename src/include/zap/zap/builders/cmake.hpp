@@ -22,12 +22,22 @@ public:
 
     const std::string& trace_file() const;
 
+    // Whether the File API is used instead of tracing
+    bool use_fileapi() const;
+
+    // Configured project has nothing to compile for install
+    bool header_only() const;
+
 private:
+    void find_version();
+
     zap::prog cmake_;
     zap::prog make_;
     std::string build_dir_;
     std::string stage_dir_;
     std::string trace_file_;
+    std::size_t major_ = 0;
+    std::size_t minor_ = 0;
 };
 
 }
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+#include <re2/re2.h>
+
+#include <zap/toolchain.hpp>
+#include <zap/types.hpp>
+#include <zap/files.hpp>
+#include <zap/cmake/project.hpp>
+
+namespace zap::cmake {
+
+// Library target as read from a codemodel-v2 target object
+struct fileapi_target
+{
+    std::string id;
+    std::string name;
+    // Public header directory, from file sets or guessed
+    std::string interface_dir;
+    bool from_file_sets = false;
+    // Header sources, relative to their file set base directory or
+    // absolute
+    zap::files headers;
+    // Non-system project include directories, in compile order
+    zap::strings includes;
+    zap::strings deps;
+};
+
+using fileapi_targets = std::vector<fileapi_target>;
+
+// CMake File API (codemodel-v2) reader
+//
+// Available since CMake 3.14, a query written in the build directory
+// before configuring makes CMake write the code model as JSON replies,
+// much cheaper than tracing the whole configure step.
+class fileapi_parser
+{
+public:
+    using json = nlohmann::json;
+
+    fileapi_parser(const zap::toolchain& tc);
+
+    virtual ~fileapi_parser();
+
+    static bool supported(std::size_t major, std::size_t minor);
+
+    // Must be called before configuring
+    static void write_query(const std::string& build_dir);
+
+    void parse(
+        const std::string& src_dir,
+        const std::string& build_dir
+    );
+
+    void post_install(const std::string& inst_dir);
+
+    // Whether a configured project has nothing to compile for install:
+    // no installed target (INTERFACE libraries are only listed when they
+    // have sources) and no custom target. Executables and libraries that
+    // aren't installed (tests, examples...) don't count.
+    bool header_only(const std::string& build_dir);
+
+    const zap::cmake::project& project() const;
+
+private:
+    json read_reply(const std::string& file) const;
+    std::string find_codemodel() const;
+
+    bool parse_target(const json& t, fileapi_target& ft) const;
+    void add_target(fileapi_target& ft, const zap::string_set& excluded);
+
+    std::string relative(
+        const std::string& path,
+        const std::string& dir
+    ) const;
+
+    const zap::toolchain& tc_;
+    re2::RE2 hdr_re_;
+    std::string src_dir_;
+    std::string reply_dir_;
+    std::string inst_dir_;
+    zap::cmake::project p_;
+};
+
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <map>
+#include <string>
+
+#include <zap/env.hpp>
+
+namespace zap::cmake {
+
+// Feature probe results shared across CMake packages
+//
+// Results of check_include_file(), check_function_exists(),
+// check_type_size()... are taken from each configured package's
+// CMakeCache.txt and fed to later configures with -C so they skip the
+// matching try_compile runs. Results are kept per toolchain fingerprint
+// and only allowlisted, positive results are kept: a missing header or
+// function may be provided later by a package installed in the env.
+class probe_cache
+{
+public:
+    using entries = std::map<std::string, std::string>;
+
+    probe_cache(const zap::env& e);
+
+    virtual ~probe_cache();
+
+    // The -C initial cache script
+    const std::string& file() const;
+
+    bool exists() const;
+
+    // Merges the allowlisted results of a configured build tree
+    void record(const std::string& cache_file) const;
+
+    static bool allowed(const std::string& name, const std::string& value);
+
+private:
+    entries read_seed() const;
+    void write_seed(const entries& es) const;
+
+    const zap::env& env_;
+    std::string fingerprint_;
+    std::string file_;
+};
+
+}
@@ -1,31 +1,51 @@
 #pragma once
 
+#include <deque>
+#include <span>
 #include <string>
 #include <string_view>
+#include <vector>
 
 #include <re2/re2.h>
 
 #include <zap/toolchain.hpp>
+#include <zap/executor.hpp>
 #include <zap/types.hpp>
 #include <zap/cmake/project.hpp>
 
 namespace zap::cmake {
 
+// A traced command, views point into the trace file or a chunk arena
 struct cmd
 {
-    std::string subject; // The first arg, for convenience
-    zap::strings args;
-    zap::string_set arg_keys;
-    std::string file;
-    std::size_t frame;
+    std::string_view name;
+    std::string_view subject; // The first arg, for convenience
+    std::span<const std::string_view> args;
+    std::string_view file;
+    std::size_t frame = 0;
 
-    bool has(const std::string& key) const;
+    bool has(std::string_view key) const;
 };
 
+using cmds = std::vector<cmd>;
+
+// Commands of a slice of the trace, in trace order
+struct trace_chunk
+{
+    std::string_view text;
+    zap::cmake::cmds cmds;
+    // Arguments of all commands, contiguous per command
+    zap::string_views args;
+    // Storage for the few strings with JSON escapes
+    std::deque<std::string> arena;
+};
+
+using trace_chunks = std::vector<trace_chunk>;
+
 class trace_parser
 {
 public:
-    trace_parser(const zap::toolchain& tc);
+    trace_parser(const zap::toolchain& tc, zap::executor& exec);
 
     virtual ~trace_parser();
 
@@ -39,39 +59,40 @@ public:
     const zap::cmake::project& project() const;
 
 private:
+    void scan(trace_chunk& c) const;
+    void apply(const cmd& c);
+
     void handle_deps();
 
-    void parse_subdirectory(const std::string& line);
+    void parse_subdirectory(const cmd& c);
 
-    void parse_library(const std::string& line);
+    void parse_library(const cmd& c);
 
-    void parse_library_sources(const std::string& line);
+    void parse_library_sources(const cmd& c);
 
     void parse_library_sources(
-        const std::string& lib,
-        const zap::strings& args
+        std::string_view lib,
+        std::span<const std::string_view> args
     );
 
-    void parse_library_includes(const std::string& line);
+    void parse_library_includes(const cmd& c);
 
-    void parse_library_deps(const std::string& line);
+    void parse_library_deps(const cmd& c);
 
-    bool not_a_library(const std::string& s) const;
+    bool not_a_library(std::string_view s) const;
 
-    zap::string_views parse_build_interface(const std::string& s) const;
-    zap::string_views parse_install_interface(const std::string& s) const;
+    zap::string_views parse_build_interface(std::string_view s) const;
+    zap::string_views parse_install_interface(std::string_view s) const;
 
     zap::string_views parse_interface(
-        const std::string& s,
+        std::string_view s,
         const std::string_view& interface
     ) const;
 
     bool ignore_library(const cmd& c) const;
 
-    cmd parse_cmd(const std::string& line) const;
-    std::string make_cmd(const std::string& cmd) const;
-
     const zap::toolchain& tc_;
+    zap::executor& exec_;
     re2::RE2 hdr_re_;
     std::string src_dir_;
     std::string inst_dir_;
@@ -3,6 +3,7 @@
 #include <string>
 
 #include <zap/command.hpp>
+#include <zap/project.hpp>
 #include <zap/types.hpp>
 
 namespace zap::commands {
@@ -10,6 +11,10 @@ namespace zap::commands {
 struct analyze_opts
 {
     std::string directory;
+    std::size_t top = 20;
+    std::string build_dir;
+    std::string ninja_dir;
+    std::string json_file;
 };
 
 class analyze : public zap::command
@@ -21,7 +26,13 @@ public:
     void operator()() final;
 
 private:
+    void analyze_links();
+    void analyze_headers();
+    void analyze_build_time();
+    void analyze_critical_path();
+
     analyze_opts opts_;
+    project p_;
 };
 
 }
@@ -9,7 +9,8 @@ enum class env_cmd
     new_env,
     delete_env,
     ls_env,
-    ls_pkgs
+    ls_pkgs,
+    which
 };
 
 struct env_opts
@@ -17,6 +18,7 @@ struct env_opts
     env_cmd cmd;
     std::string name;
     std::string directory;
+    std::string file;
 };
 
 class env : public zap::command
@@ -32,6 +34,7 @@ private:
     void delete_env();
     void ls_env();
     void ls_pkgs();
+    void which();
 
     env_opts opts_;
 };
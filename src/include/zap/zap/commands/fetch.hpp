@@ -0,0 +1,29 @@
+#pragma once
+
+#include <string>
+
+#include <zap/command.hpp>
+#include <zap/types.hpp>
+
+namespace zap::commands {
+
+struct fetch_opts
+{
+    zap::strings urls;
+    std::string file;
+    std::size_t jobs = 4;
+};
+
+class fetch : public zap::command
+{
+public:
+    fetch(const zap::env& e, const fetch_opts& opts);
+    virtual ~fetch();
+
+    void operator()() final;
+
+private:
+    fetch_opts opts_;
+};
+
+}
@@ -12,7 +12,13 @@ struct install_opts
     std::string url;
     std::string file;
     std::string directory;
+    std::string zapfile;
     zap::strings args;
+    // Pinned digest of the archive at url
+    std::string digest;
+    bool fresh = false;
+    // Concurrent downloads when installing from a file
+    std::size_t prefetch = 4;
 };
 
 class install : public zap::command
@@ -25,8 +31,31 @@ public:
 
 private:
     void install_url(const std::string& url);
+    void install_file(const std::string& file);
     void install_directory(const std::string& dir);
-    void install_archive(const archive_info& ai);
+
+    // Installs the dependencies of a Zapfile, as locked in its lock file
+    // when up to date
+    void install_zapfile(const std::string& file);
+
+    // Builds and installs a downloaded archive, unless up to date
+    void install_work(
+        const archive_info& ai,
+        const zap::strings& args,
+        const std::string& build = {}
+    );
+
+    void install_archive(
+        const archive_info& ai,
+        const zap::strings& args,
+        const std::string& build = {}
+    );
+
+    // Installed from the same work directory with the same arguments
+    bool up_to_date(const archive_info& ai, const zap::strings& args) const;
+
+    // Arguments of the last install from a work directory
+    static std::string stamp_file(const archive_info& ai);
 
     install_opts opts_;
 };
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <string>
+
+#include <zap/command.hpp>
+#include <zap/types.hpp>
+
+namespace zap::commands {
+
+enum class mirror_cmd
+{
+    sync
+};
+
+struct mirror_opts
+{
+    mirror_cmd cmd;
+    std::string directory;
+    std::string file;
+    std::size_t jobs = 4;
+};
+
+class mirror : public zap::command
+{
+public:
+    mirror(const zap::env& e, const mirror_opts& opts);
+    virtual ~mirror();
+
+    void operator()() final;
+
+private:
+    void sync();
+
+    // Archive URLs and pinned digests of the package list or of the
+    // Zapfile dependencies
+    void load_urls(zap::strings& urls, zap::string_map& digests) const;
+
+    mirror_opts opts_;
+};
+
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <zap/command.hpp>
+#include <zap/elf.hpp>
+#include <zap/prefetcher.hpp>
+#include <zap/zapfile_lock.hpp>
+#include <zap/types.hpp>
+
+namespace zap::commands {
+
+struct sync_opts
+{
+    std::string zapfile = "Zapfile";
+    // Concurrent builds of a wave
+    std::size_t jobs = 2;
+    // Concurrent downloads
+    std::size_t prefetch = 4;
+    // Only shows the plan
+    bool dry_run = false;
+};
+
+enum class sync_action
+{
+    none,
+    install,
+    upgrade,
+    rebuild
+};
+
+// Reconciles an environment with a Zapfile
+//
+// Each dependency has inputs: its archive digest, its options and the
+// inputs of the dependencies it requires. Only those whose inputs differ
+// from the ones they were last synced with are (re)built, in waves of
+// dependencies whose requirements are all done. Dependencies removed from
+// the Zapfile are uninstalled. Packages not installed by sync are never
+// touched.
+//
+// Dependents only stale because of their requirements are not rebuilt
+// when those kept the ABI of their shared libraries: same SONAME and no
+// exported symbol removed.
+class sync : public zap::command
+{
+public:
+    sync(const zap::env& e, const sync_opts& opts);
+    virtual ~sync();
+
+    void operator()() final;
+
+private:
+    struct step
+    {
+        zap::locked_dependency* d = nullptr;
+        sync_action action = sync_action::none;
+        // Wave of the step, after those of its requirements
+        std::size_t wave = 0;
+        std::string own;
+        std::string inputs;
+        // Package installed by the last sync
+        std::string pkg;
+        // Requirements changed, not the dependency itself
+        bool reqs_only = false;
+        // Shared libraries are ABI compatible with the previous ones
+        bool compatible = true;
+    };
+
+    using steps = std::vector<step>;
+
+    // Library name (e.g. libz) -> ABI
+    using abi_map = std::unordered_map<std::string, zap::elf_abi>;
+
+    // Fetches archives of dependencies not locked yet, for their digest
+    bool fetch_unlocked();
+
+    void plan();
+    void set_waves();
+    void set_inputs();
+
+    void print_plan() const;
+
+    void remove();
+    void run();
+    void run_step(step& s);
+
+    // Requirements changed but kept their ABI, marks s up to date
+    bool skip_step(step& s);
+
+    // Shared libraries installed by a package
+    abi_map shared_abis(const std::string& pkg) const;
+
+    // Prints the verdict and the changed symbols
+    bool check_abi(
+        const step& s,
+        const abi_map& before,
+        const abi_map& after
+    ) const;
+
+    zap::zapfile_lock lock_;
+    steps steps_;
+    // Dependency name -> step
+    std::unordered_map<std::string, std::size_t> index_;
+    // Synced dependencies not in the Zapfile anymore
+    env_db_synceds removed_;
+    std::unique_ptr<zap::prefetcher> pf_;
+    // Installs into the env and its database are serialized
+    std::mutex m_;
+    std::string last_dir_;
+    sync_opts opts_;
+};
+
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <zap/command.hpp>
+#include <zap/types.hpp>
+
+namespace zap::commands {
+
+struct uninstall_opts
+{
+    zap::strings pkgs;
+};
+
+class uninstall : public zap::command
+{
+public:
+    uninstall(const zap::env& e, const uninstall_opts& opts);
+    virtual ~uninstall();
+
+    void operator()() final;
+
+private:
+    uninstall_opts opts_;
+};
+
+}
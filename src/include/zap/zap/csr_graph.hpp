@@ -0,0 +1,193 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <zap/executor.hpp>
+#include <zap/types.hpp>
+#include <zap/log.hpp>
+
+namespace zap {
+
+// Compact dependency graph
+//
+// Node names are interned into dense integer ids and edges are stored in
+// compressed sparse row form once build() is called. An edge a -> b means
+// that a depends on b, so b must be done before a.
+class csr_graph
+{
+public:
+    using node_id = std::uint32_t;
+    using node_ids = std::vector<node_id>;
+    using node_span = std::span<const node_id>;
+    using positions = std::vector<std::size_t>;
+
+    // Groups of nodes stored contiguously, group i spans
+    // nodes[offsets[i], offsets[i + 1])
+    struct groups
+    {
+        node_ids nodes;
+        positions offsets{ 0 };
+
+        std::size_t size() const;
+        bool empty() const;
+
+        node_span operator[](std::size_t i) const;
+
+        void add(node_span ns);
+    };
+
+    csr_graph();
+    virtual ~csr_graph();
+
+    void clear();
+
+    node_id add_node(const std::string& name);
+    void add_edge(node_id from, node_id to);
+    void add_edge(const std::string& from, const std::string& to);
+
+    bool has_node(const std::string& name) const;
+    node_id id(const std::string& name) const;
+    const std::string& name(node_id v) const;
+
+    std::size_t size() const;
+    std::size_t edge_count() const;
+
+    // Builds the CSR arrays from added edges, duplicates are dropped and
+    // insertion order is preserved
+    void build();
+    bool built() const;
+
+    node_span edges(node_id v) const;
+    node_span rev_edges(node_id v) const;
+
+    std::size_t out_degree(node_id v) const;
+    std::size_t in_degree(node_id v) const;
+
+    // Strongly connected components, dependencies first (iterative Tarjan)
+    groups sccs() const;
+
+    bool has_cycles() const;
+
+    // All nodes, dependencies first
+    node_ids toposort() const;
+
+    // Nodes grouped in waves, every node of a wave only depends on nodes
+    // of previous waves
+    groups waves() const;
+
+private:
+    void check_built() const;
+    void check_acyclic(const groups& comps) const;
+
+    using id_map = std::unordered_map<std::string, node_id>;
+
+    strings names_;
+    id_map ids_;
+    std::vector<std::pair<node_id, node_id>> pending_;
+    positions offs_;
+    node_ids adj_;
+    positions rev_offs_;
+    node_ids rev_adj_;
+    bool built_ = false;
+};
+
+// Thread-safe ready queue over a built acyclic csr_graph
+//
+// Each node tracks how many of its dependencies remain, calling done()
+// on a node returns the dependents that just became ready.
+class ready_queue
+{
+public:
+    using node_id = csr_graph::node_id;
+    using node_ids = csr_graph::node_ids;
+
+    ready_queue(const csr_graph& g);
+    virtual ~ready_queue();
+
+    const node_ids& initial() const;
+
+    node_ids done(node_id v);
+
+    bool finished() const;
+
+private:
+    const csr_graph& g_;
+    std::unique_ptr<std::atomic<std::uint32_t>[]> remaining_;
+    std::atomic<std::size_t> left_;
+    node_ids initial_;
+};
+
+// Runs cb(node_id) for every node of g on exec, a node is only scheduled
+// once all its dependencies are done. The first exception thrown by cb
+// stops scheduling and is rethrown once running calls are over.
+template <typename Callable>
+void
+run_graph(zap::executor& exec, const csr_graph& g, Callable&& cb)
+{
+    ready_queue rq(g);
+    std::mutex m;
+    std::condition_variable cv;
+    std::exception_ptr eptr;
+    std::size_t pending = 0;
+
+    std::function<void(csr_graph::node_id)> schedule;
+
+    schedule = [&](csr_graph::node_id v) {
+        {
+            std::lock_guard<std::mutex> l(m);
+
+            if (eptr) {
+                return;
+            }
+
+            ++pending;
+        }
+
+        exec.silent_async([&, v] {
+            try {
+                cb(v);
+
+                for (auto w : rq.done(v)) {
+                    schedule(w);
+                }
+            } catch (...) {
+                std::lock_guard<std::mutex> l(m);
+
+                if (!eptr) {
+                    eptr = std::current_exception();
+                }
+            }
+
+            std::lock_guard<std::mutex> l(m);
+
+            --pending;
+            cv.notify_one();
+        });
+    };
+
+    for (auto v : rq.initial()) {
+        schedule(v);
+    }
+
+    std::unique_lock<std::mutex> lk(m);
+
+    cv.wait(lk, [&] { return pending == 0; });
+
+    if (eptr) {
+        std::rethrow_exception(eptr);
+    }
+
+    die_unless(rq.finished(), "dependency cycle prevents scheduling");
+}
+
+}
@@ -1,12 +1,16 @@
 #pragma once
 
+#include <algorithm>
+#include <iterator>
 #include <mutex>
+#include <system_error>
 
 #include <sqlite_orm/sqlite_orm.h>
 
 #include <zap/db/storage_base.hpp>
 #include <zap/log.hpp>
 #include <zap/scope.hpp>
+#include <zap/utils.hpp>
 
 namespace zap::db {
 
@@ -16,6 +20,59 @@ enum class op
     write
 };
 
+// Rows per multi-row statement, well below SQLite's bound parameters limit
+inline constexpr std::size_t batch_size = 256;
+
+// Memory mapped I/O for reads
+inline constexpr std::size_t mmap_size = 256 * 1024 * 1024;
+
+// Milliseconds to wait for locks held by other processes
+inline
+std::size_t
+busy_timeout()
+{
+    static const auto timeout = env_setting("ZAP_DB_BUSY_TIMEOUT", 10000);
+
+    return timeout;
+}
+
+// Write transactions still failing after the busy timeout are retried
+inline
+std::size_t
+busy_retries()
+{
+    static const auto retries = env_setting("ZAP_DB_BUSY_RETRIES", 3);
+
+    return retries;
+}
+
+inline
+bool
+is_busy(const std::system_error& e)
+{
+    return
+        e.code().category() == sqlite_orm::get_sqlite_error_category()
+        &&
+        (e.code().value() == SQLITE_BUSY || e.code().value() == SQLITE_LOCKED)
+        ;
+}
+
+// Prepared statement reused across calls, to be used within exec_read()
+// or exec_write() which serialize access to the connection
+template <typename Statement>
+struct prepared
+{
+    prepared(Statement s)
+    : stmt(std::move(s))
+    {}
+
+    template <typename Callable>
+    auto with(Callable&& cb)
+    { return cb(stmt); }
+
+    Statement stmt;
+};
+
 template <typename StorageSpec>
 struct dbi : storage_base
 {
@@ -40,6 +97,29 @@ struct dbi : storage_base
     db_type& get_db(storage_ptr& p)
     { return get(p).db_; }
 
+    // Opens the database for the storage lifetime, the schema is only
+    // synced when StorageSpec::version is newer than the database one
+    void open()
+    {
+        db_.on_open = [](sqlite3* h) {
+            auto pragmas = cat(
+                "PRAGMA busy_timeout=", busy_timeout(), ";",
+                "PRAGMA journal_mode=WAL;",
+                "PRAGMA synchronous=NORMAL;",
+                "PRAGMA mmap_size=", mmap_size, ";"
+            );
+
+            ::sqlite3_exec(h, pragmas.c_str(), nullptr, nullptr, nullptr);
+        };
+
+        db_.open_forever();
+
+        if (db_.pragma.user_version() < StorageSpec::version) {
+            db_.sync_schema(true);
+            db_.pragma.user_version(StorageSpec::version);
+        }
+    }
+
     template <typename Record, typename Col, typename Value>
     Record ensure_exists(const std::string& label, Col&& col, Value&& v)
     {
@@ -85,6 +165,27 @@ struct dbi : storage_base
         }
     }
 
+    // Batched multi-row inserts, to be called within exec_write()
+    template <typename It>
+    void insert_range(It first, It last)
+    {
+        batched(first, last, [&](auto b, auto e) { db_.insert_range(b, e); });
+    }
+
+    template <typename It>
+    void replace_range(It first, It last)
+    {
+        batched(first, last, [&](auto b, auto e) { db_.replace_range(b, e); });
+    }
+
+    template <typename Container>
+    void insert_all(const Container& c)
+    { exec_write([&](zap::scope&) { insert_range(c.begin(), c.end()); }); }
+
+    template <typename Container>
+    void replace_all(const Container& c)
+    { exec_write([&](zap::scope&) { replace_range(c.begin(), c.end()); }); }
+
     template <typename Callable>
     void exec(Callable&& cb, op o)
     {
@@ -101,16 +202,27 @@ struct dbi : storage_base
     template <typename Callable>
     void exec_write(Callable&& cb)
     {
-        try {
-            lock_type l(m_);
-
-            auto guard = db_.transaction_guard();
-            scope s;
-            cb(s);
-            s.clear();
-            guard.commit();
-        } catch (...) {
-            throw;
+        // Other processes may hold the database longer than the busy
+        // timeout, or make the transaction fail when it upgrades its
+        // read lock: it is run again from the start
+        for (std::size_t attempt = 0; ; ++attempt) {
+            try {
+                lock_type l(m_);
+
+                auto guard = db_.transaction_guard();
+                scope s;
+                cb(s);
+                s.clear();
+                guard.commit();
+
+                return;
+            } catch (const std::system_error& e) {
+                if (!is_busy(e) || attempt >= busy_retries()) {
+                    throw;
+                }
+
+                warn("database busy, retrying: ", e.what());
+            }
         }
     }
 
@@ -125,6 +237,23 @@ struct dbi : storage_base
     }
 
 private:
+    template <typename It, typename Callable>
+    void batched(It first, It last, Callable&& cb)
+    {
+        while (first != last) {
+            auto n = std::min<std::size_t>(
+                batch_size,
+                std::distance(first, last)
+            );
+            auto next = std::next(first, n);
+
+            cb(first, next);
+            first = next;
+        }
+    }
+
+    // Readers and writers share a single connection whose state isn't
+    // thread safe: all calls are exclusive
     using mutex_type = std::recursive_mutex;
     using lock_type = std::lock_guard<mutex_type>;
 
@@ -43,6 +43,10 @@ using remote = std::variant<
 std::string
 remote_to_string(const remote& r);
 
+// Repository name (e.g. fmt for GH:fmtlib/fmt@10.0.0)
+const std::string&
+remote_name(const remote& r);
+
 remote
 to_remote(
     repository_type type,
@@ -56,6 +60,10 @@ struct dependency
     remote r;
     repository_type type;
     strings_map opts;
+    // Pinned archive digest (<algorithm>:<hex>), if any
+    std::string digest;
+    // Names of the dependencies it builds against
+    strings needs;
 
     std::string to_string() const;
 };
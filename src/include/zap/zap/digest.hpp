@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+namespace zap {
+
+// Digests are written <algorithm>:<hex>, e.g. sha256:e3b0c442..., the
+// supported algorithms being sha256 and blake3
+
+// Incremental digest
+class hasher
+{
+public:
+    hasher(const std::string& algo = "sha256");
+    virtual ~hasher();
+
+    void update(const void* data, std::size_t size);
+
+    // <algorithm>:<hex>
+    std::string final();
+
+    const std::string& algo() const;
+
+private:
+    struct state;
+
+    std::string algo_;
+    std::unique_ptr<state> state_;
+};
+
+bool valid_digest(const std::string& digest);
+
+// "sha256" for "sha256:e3b0c442..."
+std::string digest_algo(const std::string& digest);
+
+// "e3b0c442..." for "sha256:e3b0c442..."
+std::string digest_hex(const std::string& digest);
+
+// Digest of a file's content. BLAKE3 being a tree hash, subtrees of large
+// files are hashed on all cores.
+std::string digest_file(const std::string& algo, const std::string& path);
+
+// Hex encoded SHA-256 of a file's content
+std::string sha256_file(const std::string& path);
+
+// Short key of a string for file names, stable across builds and
+// platforms: the first 16 hex digits of its SHA-256
+std::string digest_key(const std::string& s);
+
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <string>
+
+namespace httplib { struct Response; }
+
+namespace zap {
+
+struct download_opts
+{
+    // Parallel connections to servers accepting byte ranges
+    std::size_t connections = 4;
+    // Ranged downloads are split in parts of that size
+    std::size_t part_size = 8 * 1024 * 1024;
+    // Attempts per part, each one resumes where the previous one stopped
+    std::size_t retries = 3;
+    // Expected <algorithm>:<hex> digest, if any
+    std::string digest;
+};
+
+// What the server said about a download
+struct download_info
+{
+    std::string etag;
+    std::string last_modified;
+    std::size_t size = 0;
+    // Of the downloaded file, in the algorithm of the expected one
+    // (sha256 by default)
+    std::string digest;
+    // False when the server confirmed a previous download is current
+    bool modified = true;
+};
+
+// HTTP(S) download of a URL into a file
+//
+// A HEAD request follows redirections and finds out the size of the file
+// and whether the server accepts byte ranges. If so, the file is
+// preallocated and its parts fetched over several keep-alive connections,
+// each one written in place with pwrite(2). Completed parts are recorded
+// in a <file>.state sidecar file, so an interrupted download only fetches
+// the missing parts when run again. Otherwise the file is streamed over a
+// single connection.
+//
+// The file is hashed while it downloads, parts being hashed in order as
+// soon as they are complete. A file not matching the expected digest is
+// removed.
+//
+// Given the validators of a previous download, the HEAD request is made
+// conditional (If-None-Match, If-Modified-Since) and nothing is fetched
+// when the server answers 304 Not Modified.
+//
+// Connections are pooled per host and reused across downloads.
+class downloader
+{
+public:
+    downloader(
+        const std::string& url,
+        const std::string& file,
+        const download_opts& opts = {},
+        const download_info& known = {}
+    );
+
+    virtual ~downloader();
+
+    download_info run();
+
+private:
+    void head();
+
+    void fetch_parts();
+    void fetch_part(int fd, std::size_t index) const;
+    void fetch_stream();
+
+    void set_info(const httplib::Response& res);
+
+    std::string digest_algo() const;
+
+    std::string state_file() const;
+
+    std::string url_;
+    std::string file_;
+    download_opts opts_;
+    download_info known_;
+    // Filled by head()
+    std::string location_;
+    download_info info_;
+    bool ranges_ = false;
+    // ETag or Last-Modified, parts of another version can't be reused
+    std::string validator_;
+};
+
+}
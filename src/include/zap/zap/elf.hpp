@@ -0,0 +1,34 @@
+#pragma once
+
+#include <string>
+
+#include <zap/types.hpp>
+
+namespace zap {
+
+// Dynamic interface of an ELF shared object
+struct elf_abi
+{
+    std::string soname;
+    // Defined global and weak dynamic symbols
+    string_set symbols;
+};
+
+// False when file isn't an ELF shared object of the host byte order
+bool read_elf_abi(const std::string& file, elf_abi& abi);
+
+struct abi_diff
+{
+    std::string old_soname;
+    std::string new_soname;
+    // Sorted, as symbol sets are
+    strings added;
+    strings removed;
+
+    // Same SONAME, no symbol removed
+    bool compatible() const;
+};
+
+abi_diff diff_abi(const elf_abi& from, const elf_abi& to);
+
+}
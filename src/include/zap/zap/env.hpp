@@ -11,6 +11,7 @@
 #include <zap/sys_db.hpp>
 #include <zap/env_db.hpp>
 #include <zap/env_paths.hpp>
+#include <zap/file_lock.hpp>
 
 namespace zap {
 
@@ -36,17 +37,75 @@ public:
 
     zap::executor& executor() const;
 
+    // Job budget of parallel builds
+    std::size_t jobs() const;
+
     const zap::os_info& os_info() const;
 
     const zap::toolchain& toolchain() const;
 
     const zap::fetcher& fetcher() const;
 
-    archive_info download_archive(const std::string& url) const;
+    // Downloads an archive to the archive store unless already there.
+    // Archives of mutable URLs (branches...) are revalidated with a
+    // conditional request, those of tags and releases never are. Archives
+    // pinned with a digest (<algorithm>:<hex>) must match it and are never
+    // revalidated.
+    archive_info fetch_archive(
+        const std::string& url,
+        const std::string& digest = {}
+    ) const;
+
+    // Work directories are kept per package, version and archive digest
+    // (commit id for git+<repo>#<ref> URLs) so later builds of the same
+    // sources are incremental
+    archive_info download_archive(
+        const std::string& url,
+        const std::string& digest = {}
+    ) const;
+
+    // Readies a work directory for a build, which must hold its "build"
+    // lock. Fresh builds start from an empty build directory.
+    void prepare_work(const archive_info& ai, bool fresh = false) const;
+
+    // Removes least recently used work directories, except keep and
+    // those being built, until they fit in ZAP_WORK_MAX_SIZE (e.g. 10G)
+    void prune_work(const std::string& keep = {}) const;
+
+    // Lock shared with other zap processes using the env, on a resource
+    // of some kind (download, extract, build...)
+    file_lock lock(
+        const std::string& kind,
+        const std::string& key,
+        bool wait = true
+    ) const;
 
 private:
-    void download_archive(scope& s, archive_info& ai) const;
+    void download_archive(
+        scope& s,
+        archive_info& ai,
+        const env_db_archive& known,
+        const std::string& digest
+    ) const;
+
+    // Whether a stored archive matches a pinned digest
+    bool check_archive(
+        archive_info& ai,
+        env_db_archive& ar,
+        const std::string& digest
+    ) const;
+
     void extract_archive(scope& s, archive_info& ai) const;
+    void download_repo(scope& s, archive_info& ai) const;
+
+    // Moves extracted sources into the work directory of ai
+    void make_work_dir(
+        archive_info& ai,
+        const std::string& src,
+        const std::string& digest
+    ) const;
+
+    bool find_work_dir(archive_info& ai, const std::string& digest) const;
 
     void set_temp_dir(scope& s, archive_info& ai) const;
 
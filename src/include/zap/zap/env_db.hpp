@@ -2,12 +2,15 @@
 
 #include <string>
 #include <memory>
+#include <unordered_map>
 
 #include <zap/env_db_types.hpp>
 #include <zap/db/storage_base.hpp>
 
 namespace zap {
 
+struct env_db_statements;
+
 class env_db
 {
 public:
@@ -19,15 +22,37 @@ public:
     void init(const std::string& dir);
 
     env_db_pkgs packages();
+    env_db_pkg_file_list package_files(const std::string& name);
+
+    // File is relative to the env root
+    bool file_owner(const std::string& file, std::string& pkg);
+
+    bool has_package(const std::string& name, env_db_pkg& pkg);
+
+    // Replaces the package and its file list in a single transaction
+    void set_package(const env_db_pkg& pkg, const strings& files);
+    void remove_package(const std::string& name);
 
     bool has_archive(const std::string& url, env_db_archive& ar);
     void add_archive(const env_db_archive& ar);
 
+    env_db_build_times build_times();
+    void set_build_time(const env_db_build_time& bt);
+
+    env_db_synceds synced();
+    void set_synced(const env_db_synced& s);
+    void remove_synced(const std::string& name);
+
 private:
+    using dir_ids = std::unordered_map<std::string, std::int64_t>;
+
+    std::int64_t intern_dir(const std::string& dir, dir_ids& ids);
+
     auto& db();
     auto& dbi();
 
     zap::db::storage_ptr db_ptr_;
+    std::unique_ptr<env_db_statements> stmts_;
 };
 
 using env_db_ptr = std::unique_ptr<env_db>;
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <vector>
 
 #include <zap/types.hpp>
@@ -20,16 +21,67 @@ struct env_db_pkg_file
     std::string file;
 };
 
+// Interned directory of installed files
+struct env_db_dir
+{
+    std::int64_t id = 0;
+    std::string path;
+};
+
+// Installed file, owned by the last package that installed it
+struct env_db_file
+{
+    std::int64_t dir_id = 0;
+    std::string name;
+    std::string pkg;
+};
+
+using env_db_pkg_file_list = std::vector<env_db_pkg_file>;
+
 struct env_db_pkg_files
 {
     std::string pkg;
     string_set files;
 };
 
+struct env_db_build_time
+{
+    std::string pkg;
+    // Last build durations, in milliseconds
+    std::size_t configure_ms = 0;
+    std::size_t build_ms = 0;
+};
+
+using env_db_build_times = std::vector<env_db_build_time>;
+
 struct env_db_archive
 {
     std::string url;
     std::string file;
+    // Validators and length sent by the server, for revalidation
+    std::string etag;
+    std::string last_modified;
+    std::size_t size = 0;
+    // sha256:<hex>, trusted as long as the file is in the store
+    std::string digest;
+    // Last digest of another algorithm the file was verified against
+    std::string pinned;
+};
+
+// Zapfile dependency installed by zap sync
+struct env_db_synced
+{
+    // Dependency name in the Zapfile
+    std::string name;
+    std::string url;
+    // Installed package
+    std::string pkg;
+    // Digest of the archive and build options
+    std::string own;
+    // Digest of own and of the inputs of dependencies
+    std::string inputs;
 };
 
+using env_db_synceds = std::vector<env_db_synced>;
+
 }
@@ -3,20 +3,54 @@
 #include <string>
 #include <memory>
 
+#include <zap/types.hpp>
 #include <zap/env_paths.hpp>
+#include <zap/downloader.hpp>
 
 namespace zap {
 
+// Downloads archives
+//
+// Mirrors listed in ZAP_MIRRORS (separated by spaces) are tried in order
+// before the upstream URL. They are local directories, file:// roots or
+// HTTP(S) base URLs, holding archives at <host>/<path> of their upstream
+// URL (e.g. <mirror>/github.com/a/b/archive/refs/tags/v1.0.zip), which
+// is the layout written by 'zap mirror sync'.
 class fetcher
 {
 public:
     fetcher(const env_paths& ep);
     virtual ~fetcher();
 
-    virtual void download(
+    // Nothing is fetched when the known validators are still current,
+    // files not matching digest (<algorithm>:<hex>) are rejected
+    virtual download_info download(
         const std::string& url,
         const std::string& dir,
-        const std::string& filename
+        const std::string& filename,
+        const download_info& known = {},
+        const std::string& digest = {}
+    ) const;
+
+    // Tag, release and commit URLs always point to the same archive
+    virtual bool immutable(const std::string& url) const;
+
+    const strings& mirrors() const;
+
+    // Relative path of an archive in mirrors
+    static std::string mirror_path(const std::string& url);
+
+    // Updates the shared bare mirror of repo, returns the commit id of ref
+    virtual std::string fetch_repo(
+        const std::string& repo,
+        const std::string& ref
+    ) const;
+
+    // Writes the files of a mirrored commit to dir
+    virtual void checkout_repo(
+        const std::string& repo,
+        const std::string& commit,
+        const std::string& dir
     ) const;
 
     virtual void download_repo_archive(
@@ -26,7 +60,16 @@ public:
     ) const;
 
 protected:
+    // Copies local files, downloads others
+    bool fetch(
+        const std::string& from,
+        const std::string& file,
+        const std::string& digest,
+        download_info& di
+    ) const;
+
     const env_paths& ep_;
+    strings mirrors_;
 };
 
 using fetcher_ptr = std::unique_ptr<fetcher>;
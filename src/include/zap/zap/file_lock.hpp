@@ -0,0 +1,35 @@
+#pragma once
+
+#include <string>
+
+namespace zap {
+
+// Exclusive advisory lock on a file, held until destruction
+//
+// Locks belong to the open file description (flock(2)), so they exclude
+// other processes as well as other threads of the same process opening
+// the same file. They are released by the kernel when a process dies.
+class file_lock
+{
+public:
+    // Waits for the lock unless wait is false, see owns_lock()
+    file_lock(const std::string& path, bool wait = true);
+    file_lock(file_lock&& other);
+    virtual ~file_lock();
+
+    file_lock(const file_lock&) = delete;
+    file_lock& operator=(const file_lock&) = delete;
+    file_lock& operator=(file_lock&&) = delete;
+
+    const std::string& path() const;
+
+    bool owns_lock() const;
+
+    void unlock();
+
+private:
+    std::string path_;
+    int fd_ = -1;
+};
+
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <string>
+
+namespace zap {
+
+// Bare mirror of a git repository, shared by all environments
+//
+// Mirrors live in ~/.cache/zap/git. Fetches only ask for the requested
+// ref, so that after the first one only new objects are transferred, and
+// are shallow when libgit2 supports it (1.7+). Checkouts write the blobs
+// of a commit straight to a directory: no clone, no worktree metadata.
+class git_mirror
+{
+public:
+    git_mirror(const std::string& repo);
+
+    virtual ~git_mirror();
+
+    // Updates the mirror with ref (tag, branch or commit id) and returns
+    // the commit id it resolves to
+    std::string fetch(const std::string& ref) const;
+
+    void checkout(const std::string& commit, const std::string& dir) const;
+
+    const std::string& dir() const;
+
+private:
+    std::string repo_;
+    std::string dir_;
+};
+
+}
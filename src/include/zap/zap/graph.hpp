@@ -1,9 +1,7 @@
 #pragma once
 
-#include <functional>
 #include <string>
 #include <unordered_map>
-#include <stack>
 
 #include <zap/types.hpp>
 
@@ -44,32 +42,11 @@ private:
     struct node
     {
         std::string name;
-        int index;
-        int low_link;
-        bool on_stack;
         string_set edges;
         std::size_t dep_count = 0;
-
-        void reset()
-        {
-            index = -1;
-            low_link = -1;
-            on_stack = false;
-        }
     };
 
-    using node_ref = std::reference_wrapper<node>;
     using node_map = std::unordered_map<std::string, node>;
-    using node_stack = std::vector<node_ref>;
-
-    void reset();
-
-    void order_func(
-        node& v,
-        strings& ordered,
-        node_stack& st,
-        int& index
-    );
 
     node_map nodes_;
     strings ordered_;
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+
+#include <zap/target.hpp>
+#include <zap/types.hpp>
+
+namespace zap {
+
+enum class header_owner_type
+{
+    lib,
+    pkg
+};
+
+struct header_owner
+{
+    header_owner_type type;
+    std::string name;
+
+    bool is_lib() const;
+    bool is_pkg() const;
+};
+
+// Maps an include path (as written in an #include directive) to the
+// project library or installed package providing it
+class header_index
+{
+public:
+    header_index();
+    virtual ~header_index();
+
+    void clear();
+
+    std::size_t size() const;
+
+    void add_lib(const target& t);
+
+    // Files are relative to the environment root, only those below
+    // include/ are indexed
+    void add_pkg_file(const std::string& pkg, const std::string& file);
+
+    const header_owner* find(const std::string& header) const;
+
+private:
+    using owner_map = std::unordered_map<std::string, header_owner>;
+
+    owner_map owners_;
+};
+
+}
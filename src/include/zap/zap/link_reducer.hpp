@@ -0,0 +1,53 @@
+#pragma once
+
+#include <vector>
+
+#include <zap/bit_set.hpp>
+#include <zap/csr_graph.hpp>
+#include <zap/project.hpp>
+
+namespace zap {
+
+struct link_reduction_stats
+{
+    std::size_t before = 0;
+    std::size_t after = 0;
+};
+
+// Transitive reduction of project library dependencies
+//
+// A dependency is dropped when another direct dependency already provides
+// it through a chain of public dependencies: public ones may only be
+// covered by other public ones, private ones by any. Remaining libraries
+// are then ordered for linking, most dependent first.
+class link_reducer
+{
+public:
+    link_reducer(zap::project& p);
+    virtual ~link_reducer();
+
+    const link_reduction_stats& reduce();
+    const link_reduction_stats& stats() const;
+
+private:
+    void build_graph();
+    void build_closures();
+
+    void reduce(zap::targets& ts);
+    void reduce(zap::target& t);
+
+    void reduce(zap::string_set& libs, const zap::bit_set& covered) const;
+
+    void add_reach(zap::bit_set& reach, const zap::string_set& libs) const;
+
+    void order(zap::target_deps& deps) const;
+
+    zap::project& p_;
+    zap::csr_graph g_;
+    std::vector<zap::bit_set> reach_;
+    std::vector<std::size_t> rank_;
+    bool acyclic_ = true;
+    link_reduction_stats stats_;
+};
+
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+namespace zap {
+
+// Read-only memory mapping of a whole file
+class mapped_file
+{
+public:
+    mapped_file(const std::string& path);
+    virtual ~mapped_file();
+
+    mapped_file(const mapped_file&) = delete;
+    mapped_file& operator=(const mapped_file&) = delete;
+
+    const char* data() const;
+    std::size_t size() const;
+    bool empty() const;
+
+    std::string_view view() const;
+
+private:
+    const char* data_ = nullptr;
+    std::size_t size_ = 0;
+};
+
+}
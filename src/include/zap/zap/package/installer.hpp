@@ -0,0 +1,41 @@
+#pragma once
+
+#include <string>
+
+#include <zap/env.hpp>
+#include <zap/package/manifest.hpp>
+
+namespace zap::package {
+
+// Moves staged packages into the env root and removes them
+//
+// Staged files are renamed into place, whole directories at once when
+// they don't exist yet in the env, and copied (reflinked when the
+// filesystem allows it) in parallel only across filesystems. Installed
+// files are recorded in the env database, which is all uninstalls and
+// upgrades need: the env root is never walked.
+class installer
+{
+public:
+    installer(const zap::env& e);
+
+    virtual ~installer();
+
+    // Merges stage_root (the DESTDIR'ed env root) and records the files in
+    // the manifest, files of a previous version not installed anymore are
+    // removed
+    void install(const std::string& stage_root, manifest& pm) const;
+
+    void uninstall(const std::string& name) const;
+
+private:
+    void merge(const std::string& stage_root, manifest& pm) const;
+    void copy(const strings& files, const std::string& stage_root) const;
+
+    // Removes files, then their parent directories left empty
+    void remove(const strings& files) const;
+
+    const zap::env& e_;
+};
+
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <zap/types.hpp>
+
+namespace zap::package {
+
+// Line of a package list file: URL [DIGEST] [ARGS...]
+//
+// The digest pins the archive (sha256:<hex> or blake3:<hex>)
+struct list_entry
+{
+    std::string url;
+    std::string digest;
+    strings args;
+};
+
+using list = std::vector<list_entry>;
+
+// Empty lines and lines starting with '#' are skipped
+list load_list(const std::string& file);
+
+// Distinct URLs, in list order
+strings list_urls(const list& l);
+
+// URL -> digest of pinned entries
+string_map list_digests(const list& l);
+
+}
@@ -2,16 +2,34 @@
 
 #include <string>
 
+#include <zap/types.hpp>
+
 namespace zap::package {
 
+// Files installed by a package, relative to the env root
 class manifest
 {
 public:
     manifest();
+    manifest(const std::string& name, const std::string& version);
     virtual ~manifest();
 
+    const std::string& name() const;
+    const std::string& version() const;
+
+    void set_package(const std::string& name, const std::string& version);
+
+    void add_file(const std::string& file);
+
+    const strings& files() const;
+
+    bool empty() const;
+    std::size_t size() const;
+
 private:
-    std::string dir_;
+    std::string name_;
+    std::string version_;
+    strings files_;
 };
 
 }
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <atomic>
+#include <future>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <zap/env.hpp>
+
+namespace zap {
+
+// Fetches archives in the background, ahead of their builds
+//
+// Up to jobs threads download (and, unless fetch_only, verify and extract)
+// archives in list order, so that the first packages are ready first and
+// the next ones download while earlier ones build. Downloads are network
+// bound, they don't count against the build job budget. Archives with an
+// entry in digests must match it.
+class prefetcher
+{
+public:
+    prefetcher(
+        const zap::env& e,
+        const strings& urls,
+        std::size_t jobs,
+        bool fetch_only = false,
+        const string_map& digests = {}
+    );
+
+    // Pending archives are abandoned, running ones complete
+    virtual ~prefetcher();
+
+    // Waits for the archive of url, rethrows its error if it failed
+    archive_info get(const std::string& url) const;
+
+private:
+    void run();
+
+    const zap::env& e_;
+    strings urls_;
+    bool fetch_only_;
+    string_map digests_;
+    std::unordered_map<std::string, std::size_t> index_;
+    std::vector<std::promise<archive_info>> promises_;
+    std::vector<std::shared_future<archive_info>> futures_;
+    std::atomic<std::size_t> next_ = 0;
+    std::vector<std::thread> workers_;
+};
+
+}
@@ -6,6 +6,7 @@
 #include <zap/types.hpp>
 #include <zap/graph.hpp>
 #include <zap/dependency.hpp>
+#include <zap/header_index.hpp>
 
 namespace zap {
 
@@ -36,6 +37,9 @@ struct project
 
     graph g;
 
+    // Public header -> owning library or package
+    header_index headers;
+
     void add_target(targets& ts, const std::string& tname, target& t);
 };
 
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <string>
+
+#include <zap/env.hpp>
+#include <zap/files.hpp>
+#include <zap/project.hpp>
+
+namespace zap {
+
+// Finds project targets using the detected layout and resolves their
+// include dependencies to project libraries, packages or plain headers
+class project_scanner
+{
+public:
+    project_scanner(const zap::env& e, zap::project& p);
+    virtual ~project_scanner();
+
+    void find_targets(const std::string& root_dir);
+    void scan_targets();
+
+private:
+    void scan_targets(zap::targets& ts);
+    void scan_target(zap::target& t);
+
+    void scan_target_files(
+        zap::target& t,
+        const std::string& dir,
+        const zap::files& files,
+        zap::target_deps& deps
+    );
+
+    const zap::header_owner* find_owner(
+        const zap::target& t,
+        const std::string& dep
+    );
+
+    // Package installing the header in the env, if any
+    const zap::header_owner* find_pkg_owner(const std::string& dep);
+
+    const zap::env& e_;
+    zap::project& p_;
+    // Headers already looked up in the env database
+    zap::string_set env_lookups_;
+};
+
+}
@@ -9,6 +9,7 @@ namespace zap {
 struct scan_context
 {
     string_set deps;
+    string_set_map file_deps;
 
     void merge(scan_context& other);
 };
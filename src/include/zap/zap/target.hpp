@@ -52,6 +52,8 @@ struct target
     target_deps public_deps;
     target_deps private_deps;
     string_set pkg_deps;
+    // Scanned file (relative to project root) -> included headers
+    string_set_map file_deps;
 
     std::string to_string() const;
 
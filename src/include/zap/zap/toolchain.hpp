@@ -10,6 +10,7 @@
 #include <zap/executor.hpp>
 #include <zap/env_paths.hpp>
 #include <zap/scope.hpp>
+#include <zap/scan_context.hpp>
 
 namespace zap {
 
@@ -63,13 +64,21 @@ public:
         const files& f
     ) const;
 
-    virtual void scan_files(
+    void scan_files(
         const strings& inc_dirs,
         const std::string& dir,
         const files& f,
         strings& deps
     ) const;
 
+    // Also keeps the dependencies of each file in ctx.file_deps
+    virtual void scan_files(
+        const strings& inc_dirs,
+        const std::string& dir,
+        const files& f,
+        scan_context& ctx
+    ) const;
+
     virtual strings local_lib_deps(
         const std::string& file,
         const string_set& accepted
@@ -89,6 +98,10 @@ public:
 
     const std::string& name() const;
 
+    // Identifies the compilers, their version and target, changes when
+    // any of them is switched or upgraded
+    std::string fingerprint() const;
+
 protected:
     const std::string& empty_dir() const;
     const std::string& empty_file() const;
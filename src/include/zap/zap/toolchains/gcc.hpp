@@ -25,7 +25,7 @@ public:
         const zap::strings& inc_dirs,
         const std::string& dir,
         const zap::files& f,
-        zap::strings& deps
+        zap::scan_context& ctx
     ) const override;
 
     zap::strings local_lib_deps(
@@ -63,6 +63,7 @@ std::pair<bool, std::string> unique_dir(const std::string_view& path);
 std::pair<bool, std::string> unique_file(const std::string_view& path);
 bool has_dirs(const std::string_view& path);
 bool dir_is_empty(const std::string_view& path);
+std::size_t dir_size(const std::string_view& path);
 
 std::string empty_temp_dir(const std::string_view& base_dir);
 
@@ -81,6 +82,11 @@ std::string human_readable_rate(
     const std::string& user_unit = "B"
 );
 
+std::string human_readable_duration(std::size_t millisecs);
+
+// Duration of cb, in milliseconds
+std::size_t timed(const std::function<void()>& cb);
+
 std::string
 plural(
     const std::string& base,
@@ -296,4 +302,14 @@ inline
 T to_num(const std::string& s)
 { return ((T) std::strtoull(s.c_str(), NULL, 10)); }
 
+// Numeric setting from the process environment
+inline
+std::size_t
+env_setting(const char* name, std::size_t def)
+{
+    const char* val = std::getenv(name);
+
+    return val != nullptr ? to_num<std::size_t>(val) : def;
+}
+
 }
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <zap/zapfile.hpp>
+#include <zap/types.hpp>
+
+namespace zap {
+
+// Dependency as resolved and installed from a Zapfile
+struct locked_dependency
+{
+    std::string name;
+    std::string url;
+    // Digest of the archive, pinned on the next installs
+    std::string digest;
+    // Build system (cmake, autotools)
+    std::string build;
+    strings_map opts;
+    strings needs;
+};
+
+using locked_dependencies = std::vector<locked_dependency>;
+
+// Zapfile.lock
+//
+// Records the resolution of a Zapfile so that the next installs need
+// neither the remotes of the system database nor conditional requests:
+// archives are pinned to their digest, and the lock stays valid as long
+// as the Zapfile it was resolved from doesn't change.
+struct zapfile_lock
+{
+    // Digest of the Zapfile contents
+    std::string zapfile;
+    locked_dependencies deps;
+
+    // Lock file of a Zapfile
+    static std::string file_of(const std::string& zapfile);
+
+    // Loads file, if it exists. Whether it was resolved from zapfile as
+    // it is now.
+    bool load(const std::string& file, const std::string& zapfile);
+
+    void save(const std::string& file) const;
+
+    // Resolves the dependencies of zf, keeping the digests and build
+    // systems already locked for the same URLs
+    void resolve(const std::string& file, const zap::zapfile& zf);
+};
+
+}
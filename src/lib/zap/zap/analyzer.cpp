@@ -0,0 +1,24 @@
+#include <zap/analyzer.hpp>
+
+namespace zap {
+
+analyzer::analyzer(
+    const zap::env& e,
+    const project& p
+)
+: e_(e),
+p_(p)
+{}
+
+analyzer::~analyzer()
+{}
+
+const zap::env&
+analyzer::env() const
+{ return e_; }
+
+const project&
+analyzer::p() const
+{ return p_; }
+
+}
@@ -0,0 +1,503 @@
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <limits>
+
+#include <nlohmann/json.hpp>
+#include <re2/re2.h>
+
+#include <zap/analyzers/build_time.hpp>
+#include <zap/executor.hpp>
+#include <zap/text/table.hpp>
+#include <zap/utils.hpp>
+#include <zap/log.hpp>
+
+namespace zap::analyzers {
+
+using json = nlohmann::json;
+
+static const std::string time_trace_ext = ".json";
+static const std::string time_report_ext = ".ftime-report";
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Utilities
+//
+///////////////////////////////////////////////////////////////////////////////
+namespace detail {
+
+void
+add(build_time_map& m, const std::string& name, std::uint64_t usecs)
+{
+    auto& e = m[name];
+
+    if (e.name.empty()) {
+        e.name = name;
+    }
+
+    e.usecs += usecs;
+    ++e.count;
+}
+
+void
+merge(build_time_map& to, build_time_map& from)
+{
+    for (auto& p : from) {
+        auto [ it, inserted ] = to.try_emplace(p.first, std::move(p.second));
+
+        if (!inserted) {
+            it->second.usecs += p.second.usecs;
+            it->second.count += p.second.count;
+        }
+    }
+
+    from.clear();
+}
+
+build_time_entries
+sorted(build_time_map& m)
+{
+    build_time_entries entries;
+
+    entries.reserve(m.size());
+
+    for (auto& p : m) {
+        entries.emplace_back(std::move(p.second));
+    }
+
+    std::sort(
+        entries.begin(), entries.end(),
+        [](const auto& a, const auto& b) {
+            return
+                a.usecs != b.usecs
+                ? a.usecs > b.usecs
+                : a.name < b.name
+                ;
+        }
+    );
+
+    return entries;
+}
+
+json
+to_json(const build_time_entries& entries)
+{
+    auto a = json::array();
+
+    for (const auto& e : entries) {
+        a.push_back({
+            { "name", e.name },
+            { "time_ms", e.millisecs() },
+            { "count", e.count }
+        });
+    }
+
+    return a;
+}
+
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Build time entry
+//
+///////////////////////////////////////////////////////////////////////////////
+std::size_t
+build_time_entry::millisecs() const
+{ return usecs / 1000; }
+
+std::size_t
+build_time_entry::avg_millisecs() const
+{ return count > 0 ? millisecs() / count : 0; }
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Build time context
+//
+///////////////////////////////////////////////////////////////////////////////
+void
+build_time_context::merge(build_time_context& other)
+{
+    detail::merge(files, other.files);
+    detail::merge(headers, other.headers);
+    detail::merge(templates, other.templates);
+    detail::merge(functions, other.functions);
+    detail::merge(passes, other.passes);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Build time analyzer
+//
+///////////////////////////////////////////////////////////////////////////////
+build_time::build_time(
+    const zap::env& e,
+    const zap::project& p,
+    const std::string& build_dir,
+    std::size_t top
+)
+: analyzer(e, p),
+build_dir_(zap::fullpath(build_dir)),
+top_(top)
+{}
+
+build_time::~build_time()
+{}
+
+void
+build_time::analyze()
+{
+    zap::die_unless(
+        zap::directory_exists(build_dir_),
+        "build directory not found: ", build_dir_
+    );
+
+    source_targets_.clear();
+
+    add_sources(p().libs);
+    add_sources(p().mods);
+    add_sources(p().bins);
+    add_sources(p().tsts);
+
+    auto files = zap::find_files(
+        build_dir_,
+        R"(.*(?:\.json|\.ftime-report))"
+    );
+
+    auto cb = [&](auto& wctx, const auto& file) {
+        parse_file(wctx, file);
+    };
+
+    build_time_context ctx;
+
+    {
+        zap::async_pool<decltype(cb), build_time_context> ap(
+            env().executor(),
+            cb
+        );
+
+        for (const auto& file : files) {
+            ap.async(file);
+        }
+
+        ctx.merge(ap.wait());
+    }
+
+    if (ctx.files.empty()) {
+        zap::warn("no -ftime-trace or -ftime-report output in ", build_dir_);
+    }
+
+    attribute(ctx.files);
+
+    files_ = detail::sorted(ctx.files);
+    headers_ = detail::sorted(ctx.headers);
+    templates_ = detail::sorted(ctx.templates);
+    functions_ = detail::sorted(ctx.functions);
+    passes_ = detail::sorted(ctx.passes);
+}
+
+void
+build_time::print(std::ostream& os) const
+{
+    print(os, "target", targets_);
+    print(os, "translation unit", files_);
+    print(os, "header (parse)", headers_);
+    print(os, "template (instantiate)", templates_);
+    print(os, "function (codegen)", functions_);
+    print(os, "compiler pass", passes_);
+}
+
+void
+build_time::write_json(const std::string& file) const
+{
+    json j = {
+        { "build_dir", build_dir_ },
+        { "targets", detail::to_json(targets_) },
+        { "files", detail::to_json(files_) },
+        { "headers", detail::to_json(headers_) },
+        { "templates", detail::to_json(templates_) },
+        { "functions", detail::to_json(functions_) },
+        { "passes", detail::to_json(passes_) }
+    };
+
+    std::ofstream ofs(file, std::ios::binary | std::ios::trunc);
+
+    zap::die_unless(ofs.good(), "failed to open ", file);
+
+    ofs << j.dump(4) << std::endl;
+}
+
+const build_time_entries&
+build_time::targets() const
+{ return targets_; }
+
+const build_time_entries&
+build_time::files() const
+{ return files_; }
+
+const build_time_entries&
+build_time::headers() const
+{ return headers_; }
+
+const build_time_entries&
+build_time::templates() const
+{ return templates_; }
+
+const build_time_entries&
+build_time::functions() const
+{ return functions_; }
+
+const build_time_entries&
+build_time::passes() const
+{ return passes_; }
+
+void
+build_time::add_sources(const zap::targets& ts)
+{
+    for (const auto& p : ts) {
+        const auto& t = p.second;
+
+        for (const auto& s : t.sources) {
+            source_targets_.try_emplace(zap::cat_file(t.src_dir, s), t.name);
+        }
+    }
+}
+
+void
+build_time::parse_file(
+    build_time_context& ctx,
+    const std::string& file
+) const
+{
+    auto path = zap::cat_file(build_dir_, file);
+
+    std::string stem = file;
+
+    if (stem.ends_with(time_report_ext)) {
+        stem.resize(stem.size() - time_report_ext.size());
+
+        // Captured next to objects or sources, both map to the source
+        for (const std::string ext : { ".o", ".obj" }) {
+            if (stem.ends_with(ext)) {
+                stem.resize(stem.size() - ext.size());
+            }
+        }
+
+        parse_time_report(ctx, path, source_of(stem));
+    } else {
+        if (stem.ends_with(time_trace_ext)) {
+            stem.resize(stem.size() - time_trace_ext.size());
+        }
+
+        parse_time_trace(ctx, path, source_of(stem));
+    }
+}
+
+void
+build_time::parse_time_trace(
+    build_time_context& ctx,
+    const std::string& file,
+    const std::string& tu
+) const
+{
+    // Build directories hold plenty of other JSON files (compilation
+    // database, CMake file API replies...), skip them before parsing
+    auto content = zap::slurp(file);
+
+    if (!zap::contains(content, "\"traceEvents\"")) {
+        return;
+    }
+
+    auto j = json::parse(content, nullptr, false);
+
+    if (j.is_discarded() || !j.contains("traceEvents")) {
+        zap::warn("invalid time trace: ", file);
+        return;
+    }
+
+    std::uint64_t total = 0;
+    std::uint64_t first = std::numeric_limits<std::uint64_t>::max();
+    std::uint64_t last = 0;
+
+    for (const auto& ev : j["traceEvents"]) {
+        if (ev.value("ph", "") != "X") {
+            continue;
+        }
+
+        const auto name = ev.value("name", "");
+        std::uint64_t ts = ev.value("ts", std::uint64_t(0));
+        std::uint64_t dur = ev.value("dur", std::uint64_t(0));
+        std::string what;
+
+        if (name.starts_with("Total ")) {
+            // Per-event summaries, already accounted for
+            continue;
+        }
+
+        first = std::min(first, ts);
+        last = std::max(last, ts + dur);
+
+        if (ev.contains("args")) {
+            what = ev["args"].value("detail", "");
+        }
+
+        if (name == "ExecuteCompiler") {
+            total = dur;
+        } else if (name == "Source") {
+            detail::add(ctx.headers, relative(what), dur);
+        } else if (
+            name == "InstantiateClass"
+            ||
+            name == "InstantiateFunction"
+        ) {
+            detail::add(ctx.templates, what, dur);
+        } else if (name == "OptFunction") {
+            if (what.starts_with("_Z")) {
+                what = zap::demangle_type_name(what);
+            }
+
+            detail::add(ctx.functions, what, dur);
+        }
+    }
+
+    if (total == 0 && last > first) {
+        // Older clang releases have no top-level event
+        total = last - first;
+    }
+
+    detail::add(ctx.files, tu, total);
+}
+
+void
+build_time::parse_time_report(
+    build_time_context& ctx,
+    const std::string& file,
+    const std::string& tu
+) const
+{
+    //  phase parsing           :   0.37 ( 60%)   0.13 ( 87%)   0.51 ( 64%) ...
+    //  TOTAL                   :   0.62          0.15          0.80 ...
+    static const re2::RE2 pass_re(
+        R"(\s*(\S.*?)\s*:\s*[0-9.]+\s*\(\s*\d+%\)\s*[0-9.]+\s*\(\s*\d+%\))"
+        R"(\s*([0-9.]+).*)"
+    );
+    static const re2::RE2 total_re(
+        R"(\s*TOTAL\s*:\s*[0-9.]+\s+[0-9.]+\s+([0-9.]+).*)"
+    );
+
+    std::ifstream ifs(file);
+    std::string name;
+    double wall;
+    bool found = false;
+
+    for (std::string line; std::getline(ifs, line); ) {
+        if (re2::RE2::FullMatch(line, total_re, &wall)) {
+            detail::add(ctx.files, tu, std::llround(wall * 1e6));
+            found = true;
+        } else if (re2::RE2::FullMatch(line, pass_re, &name, &wall)) {
+            detail::add(ctx.passes, name, std::llround(wall * 1e6));
+        }
+    }
+
+    if (!found) {
+        zap::warn("no time report in ", file);
+    }
+}
+
+std::string
+build_time::source_of(const std::string& stem) const
+{
+    // Object paths embed the source path relative to the project root
+    // (e.g. CMakeFiles/foo.dir/src/lib/foo/foo.cpp), the longest known
+    // suffix wins
+    std::string::size_type pos = 0;
+
+    while (true) {
+        auto it = source_targets_.find(stem.substr(pos));
+
+        if (it != source_targets_.end()) {
+            return it->first;
+        }
+
+        pos = stem.find('/', pos);
+
+        if (pos == std::string::npos) {
+            break;
+        }
+
+        ++pos;
+    }
+
+    return stem;
+}
+
+std::string
+build_time::relative(const std::string& path) const
+{
+    const auto& root = p().root_dir;
+
+    if (
+        path.size() > root.size()
+        &&
+        path.starts_with(root)
+        &&
+        path[root.size()] == '/'
+    ) {
+        return path.substr(root.size() + 1);
+    }
+
+    return path;
+}
+
+void
+build_time::attribute(const build_time_map& files)
+{
+    build_time_map targets;
+
+    for (const auto& p : files) {
+        auto it = source_targets_.find(p.first);
+
+        const auto& name =
+            it != source_targets_.end()
+            ? it->second
+            : std::string{ "(unknown)" }
+            ;
+
+        auto& e = targets[name];
+
+        e.name = name;
+        e.usecs += p.second.usecs;
+        e.count += p.second.count;
+    }
+
+    targets_ = detail::sorted(targets);
+}
+
+void
+build_time::print(
+    std::ostream& os,
+    const std::string& title,
+    const build_time_entries& entries
+) const
+{
+    if (entries.empty()) {
+        return;
+    }
+
+    zap::text::table t(title, "count", "total", "average");
+
+    for (std::size_t i = 0; i < std::min(top_, entries.size()); ++i) {
+        const auto& e = entries[i];
+
+        t.add_row(
+            e.name,
+            std::to_string(e.count),
+            zap::human_readable_duration(e.millisecs()),
+            zap::human_readable_duration(e.avg_millisecs())
+        );
+    }
+
+    os << t << "\n" << std::endl;
+}
+
+}
@@ -0,0 +1,458 @@
+#include <algorithm>
+#include <limits>
+#include <set>
+#include <thread>
+#include <unordered_set>
+
+#include <nlohmann/json.hpp>
+#include <re2/re2.h>
+
+#include <zap/analyzers/critical_path.hpp>
+#include <zap/text/table.hpp>
+#include <zap/utils.hpp>
+#include <zap/log.hpp>
+
+namespace zap::analyzers {
+
+using json = nlohmann::json;
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Ninja step
+//
+///////////////////////////////////////////////////////////////////////////////
+std::size_t
+ninja_step::duration() const
+{ return end > start ? end - start : 0; }
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Critical path analyzer
+//
+///////////////////////////////////////////////////////////////////////////////
+critical_path::critical_path(
+    const zap::env& e,
+    const zap::project& p,
+    const std::string& build_dir,
+    std::size_t top
+)
+: analyzer(e, p),
+build_dir_(zap::fullpath(build_dir)),
+top_(top)
+{
+    ninja_ = zap::find_prog("ninja");
+}
+
+critical_path::~critical_path()
+{}
+
+void
+critical_path::analyze()
+{
+    steps_.clear();
+    g_.clear();
+    path_.clear();
+    targets_.clear();
+    estimates_.clear();
+
+    read_log();
+    read_graph();
+    read_deps();
+
+    g_.build();
+
+    compute();
+    estimate();
+}
+
+void
+critical_path::print(std::ostream& os) const
+{
+    zap::text::table st("build", "time");
+
+    st.add_row("wall clock", zap::human_readable_duration(wall_));
+    st.add_row("serial (work)", zap::human_readable_duration(work_));
+    st.add_row("critical path (span)", zap::human_readable_duration(span_));
+
+    os << st << "\n" << std::endl;
+
+    zap::text::table pt("critical path", "target", "time");
+
+    for (const auto& s : path_) {
+        pt.add_row(
+            s.output,
+            target_of(s.output),
+            zap::human_readable_duration(s.duration())
+        );
+    }
+
+    os << pt << "\n" << std::endl;
+
+    zap::text::table tt("target", "steps", "serial", "on critical path");
+
+    for (std::size_t i = 0; i < std::min(top_, targets_.size()); ++i) {
+        const auto& t = targets_[i];
+
+        tt.add_row(
+            t.name,
+            std::to_string(t.steps),
+            zap::human_readable_duration(t.serial),
+            zap::human_readable_duration(t.critical)
+        );
+    }
+
+    os << tt << "\n" << std::endl;
+
+    zap::text::table et("cores", "best time", "speedup");
+
+    for (const auto& ce : estimates_) {
+        char buf[50 + 1];
+
+        std::snprintf(buf, sizeof(buf), "%.2fx", ce.speedup);
+
+        et.add_row(
+            std::to_string(ce.cores),
+            zap::human_readable_duration(ce.time),
+            buf
+        );
+    }
+
+    os << et << std::endl;
+}
+
+void
+critical_path::write_json(const std::string& file) const
+{
+    auto path = json::array();
+    auto targets = json::array();
+    auto estimates = json::array();
+
+    for (const auto& s : path_) {
+        path.push_back({
+            { "output", s.output },
+            { "target", target_of(s.output) },
+            { "start_ms", s.start },
+            { "time_ms", s.duration() }
+        });
+    }
+
+    for (const auto& t : targets_) {
+        targets.push_back({
+            { "name", t.name },
+            { "steps", t.steps },
+            { "serial_ms", t.serial },
+            { "critical_ms", t.critical }
+        });
+    }
+
+    for (const auto& ce : estimates_) {
+        estimates.push_back({
+            { "cores", ce.cores },
+            { "time_ms", ce.time },
+            { "speedup", ce.speedup }
+        });
+    }
+
+    json j = {
+        { "build_dir", build_dir_ },
+        { "wall_ms", wall_ },
+        { "work_ms", work_ },
+        { "span_ms", span_ },
+        { "path", path },
+        { "targets", targets },
+        { "estimates", estimates }
+    };
+
+    std::ofstream ofs(file, std::ios::binary | std::ios::trunc);
+
+    zap::die_unless(ofs.good(), "failed to open ", file);
+
+    ofs << j.dump(4) << std::endl;
+}
+
+const ninja_steps&
+critical_path::path() const
+{ return path_; }
+
+const target_times&
+critical_path::targets() const
+{ return targets_; }
+
+const core_estimates&
+critical_path::estimates() const
+{ return estimates_; }
+
+std::size_t
+critical_path::work() const
+{ return work_; }
+
+std::size_t
+critical_path::span() const
+{ return span_; }
+
+std::size_t
+critical_path::wall() const
+{ return wall_; }
+
+void
+critical_path::read_log()
+{
+    auto log_file = zap::cat_file(build_dir_, ".ninja_log");
+
+    zap::die_unless(
+        zap::file_exists(log_file),
+        "no Ninja log in ", build_dir_
+    );
+
+    std::ifstream ifs(log_file);
+    std::size_t last_end = 0;
+
+    // <start ms> <end ms> <restat mtime> <output> <command hash>
+    for (std::string line; std::getline(ifs, line); ) {
+        if (line.empty() || line.front() == '#') {
+            continue;
+        }
+
+        auto fields = zap::split("\t", line);
+
+        if (fields.size() < 5) {
+            continue;
+        }
+
+        ninja_step s{
+            std::string{ fields[3] },
+            std::stoul(std::string{ fields[0] }),
+            std::stoul(std::string{ fields[1] }),
+            std::string{ fields[4] }
+        };
+
+        // Entries are appended as steps end, times going back means
+        // a new build started: only the last one is of interest
+        if (s.end < last_end) {
+            steps_.clear();
+        }
+
+        last_end = s.end;
+        steps_.insert_or_assign(s.output, std::move(s));
+    }
+
+    zap::die_if(steps_.empty(), "empty Ninja log in ", build_dir_);
+}
+
+void
+critical_path::read_graph()
+{
+    // "0x1234" [label="out.o"]
+    // "0x5678" [label="rule", shape=ellipse]
+    // "0x1234" -> "0x5678" [arrowhead=none]
+    static const re2::RE2 node_re(
+        R"re("([^"]+)" \[label="(.*?)"(, shape=ellipse)?\])re"
+    );
+    static const re2::RE2 edge_re(R"re("([^"]+)" -> "([^"]+)".*)re");
+
+    auto res = ninja_.run_silent({
+        .args = { "-C", build_dir_, "-t", "graph" }
+    });
+
+    auto lines = res.out_lines();
+    zap::string_map labels;
+    std::string id;
+    std::string label;
+    std::string ellipse;
+    std::string to;
+
+    // Edges may reference nodes declared later on
+    for (const auto& line : lines) {
+        if (re2::RE2::FullMatch(line, node_re, &id, &label, &ellipse)) {
+            // Multiple inputs/outputs edges get their own node, keep their
+            // unique id so they stay distinct
+            labels.insert_or_assign(id, ellipse.empty() ? label : id);
+        }
+    }
+
+    for (const auto& line : lines) {
+        if (re2::RE2::FullMatch(line, edge_re, &id, &to)) {
+            auto from_it = labels.find(id);
+            auto to_it = labels.find(to);
+
+            if (from_it != labels.end() && to_it != labels.end()) {
+                // Inputs point to outputs, outputs depend on inputs
+                g_.add_edge(to_it->second, from_it->second);
+            }
+        }
+    }
+}
+
+void
+critical_path::read_deps()
+{
+    // Header dependencies only order steps when they're generated
+    auto res = ninja_.run_silent({
+        .args = { "-C", build_dir_, "-t", "deps" }
+    });
+
+    std::string output;
+
+    for (const auto& line : res.out_lines()) {
+        if (line.empty()) {
+            continue;
+        } else if (line.front() != ' ') {
+            auto pos = line.find(": #deps");
+
+            output =
+                pos != std::string_view::npos
+                ? std::string{ line.substr(0, pos) }
+                : std::string{}
+                ;
+        } else if (!output.empty()) {
+            auto pos = line.find_first_not_of(' ');
+            std::string dep{ line.substr(pos) };
+
+            if (g_.has_node(output) && steps_.contains(dep)) {
+                g_.add_edge(output, dep);
+            }
+        }
+    }
+}
+
+void
+critical_path::compute()
+{
+    auto n = g_.size();
+    std::vector<std::size_t> dist(n, 0);
+    csr_graph::node_ids pred(n, n);
+
+    auto duration = [&](auto v) -> std::size_t {
+        auto it = steps_.find(g_.name(v));
+
+        return it != steps_.end() ? it->second.duration() : 0;
+    };
+
+    // Dependencies first so predecessors are final when reached
+    for (auto v : g_.toposort()) {
+        for (auto w : g_.edges(v)) {
+            if (pred[v] == n || dist[w] > dist[pred[v]]) {
+                pred[v] = w;
+            }
+        }
+
+        dist[v] = duration(v) + (pred[v] != n ? dist[pred[v]] : 0);
+    }
+
+    auto last = std::max_element(dist.begin(), dist.end());
+    csr_graph::node_id v = n;
+
+    if (last != dist.end()) {
+        span_ = *last;
+        v = last - dist.begin();
+    } else {
+        span_ = 0;
+    }
+
+    for (; v != n; v = pred[v]) {
+        auto it = steps_.find(g_.name(v));
+
+        if (it != steps_.end()) {
+            path_.push_back(it->second);
+        }
+    }
+
+    std::reverse(path_.begin(), path_.end());
+
+    // Outputs of a same edge share their log times and command hash
+    std::unordered_set<std::string> seen;
+    std::unordered_map<std::string, target_time> targets;
+    std::size_t first = std::numeric_limits<std::size_t>::max();
+    std::size_t end = 0;
+
+    work_ = 0;
+
+    for (const auto& p : steps_) {
+        const auto& s = p.second;
+
+        first = std::min(first, s.start);
+        end = std::max(end, s.end);
+
+        if (!seen.insert(zap::cat(s.hash, ':', s.start)).second) {
+            continue;
+        }
+
+        auto name = target_of(s.output);
+        auto& t = targets[name];
+
+        t.name = name;
+        ++t.steps;
+        t.serial += s.duration();
+        work_ += s.duration();
+    }
+
+    for (const auto& s : path_) {
+        targets[target_of(s.output)].critical += s.duration();
+    }
+
+    wall_ = end > first ? end - first : 0;
+
+    for (auto& p : targets) {
+        targets_.emplace_back(std::move(p.second));
+    }
+
+    std::sort(
+        targets_.begin(), targets_.end(),
+        [](const auto& a, const auto& b) {
+            return
+                a.serial != b.serial
+                ? a.serial > b.serial
+                : a.name < b.name
+                ;
+        }
+    );
+}
+
+void
+critical_path::estimate()
+{
+    std::set<std::size_t> cores = { 1, 2, 4, 8, 16, 32, 64 };
+
+    cores.insert(std::max(1u, std::thread::hardware_concurrency()));
+
+    for (auto c : cores) {
+        core_estimate ce{ c };
+
+        ce.time = std::max((work_ + c - 1) / c, span_);
+
+        if (ce.time > 0) {
+            ce.speedup = static_cast<double>(work_) / ce.time;
+        }
+
+        estimates_.push_back(ce);
+    }
+}
+
+std::string
+critical_path::target_of(const std::string& output) const
+{
+    // Objects: CMakeFiles/<target>.dir/...
+    static const re2::RE2 obj_re(R"((?:.*/)?CMakeFiles/([^/]+)\.dir/.*)");
+    // Binaries and libraries: [lib]<target>[.so.1.2|.a|...]
+    static const re2::RE2 bin_re(R"((?:lib)?([^./]+)(?:\..*)?)");
+
+    std::string name;
+
+    if (re2::RE2::FullMatch(output, obj_re, &name)) {
+        return name;
+    }
+
+    auto base = zap::basename(output);
+
+    if (re2::RE2::FullMatch(base, bin_re, &name)) {
+        for (const auto* ts : { &p().libs, &p().mods, &p().bins, &p().tsts }) {
+            if (ts->contains(name)) {
+                return name;
+            }
+        }
+    }
+
+    return "(other)";
+}
+
+}
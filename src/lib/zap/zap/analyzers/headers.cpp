@@ -0,0 +1,269 @@
+#include <algorithm>
+
+#include <zap/analyzers/headers.hpp>
+#include <zap/bit_set.hpp>
+#include <zap/text/table.hpp>
+#include <zap/utils.hpp>
+
+namespace zap::analyzers {
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Header cost
+//
+///////////////////////////////////////////////////////////////////////////////
+std::size_t
+header_cost::cost() const
+{ return fan_in * pp_size; }
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Header analyzer
+//
+///////////////////////////////////////////////////////////////////////////////
+headers::headers(
+    const zap::env& e,
+    const zap::project& p,
+    std::size_t top
+)
+: analyzer(e, p),
+top_(top)
+{}
+
+headers::~headers()
+{}
+
+void
+headers::analyze()
+{
+    g_.clear();
+    is_tu_.clear();
+    hdrs_.clear();
+    tus_.clear();
+
+    add_targets(p().libs);
+    add_targets(p().mods);
+    add_targets(p().bins);
+    add_targets(p().tsts);
+
+    g_.build();
+
+    compute();
+}
+
+void
+headers::print(std::ostream& os) const
+{
+    zap::text::table ht("header", "TUs", "size", "preprocessed", "cost");
+
+    for (std::size_t i = 0; i < std::min(top_, hdrs_.size()); ++i) {
+        const auto& h = hdrs_[i];
+
+        ht.add_row(
+            h.header,
+            std::to_string(h.fan_in),
+            zap::human_readable_size(h.size),
+            zap::human_readable_size(h.pp_size),
+            zap::human_readable_size(h.cost())
+        );
+    }
+
+    zap::text::table tt("translation unit", "headers", "included");
+
+    for (std::size_t i = 0; i < std::min(top_, tus_.size()); ++i) {
+        const auto& tu = tus_[i];
+
+        tt.add_row(
+            tu.file,
+            std::to_string(tu.headers),
+            zap::human_readable_size(tu.bytes)
+        );
+    }
+
+    os << ht << "\n\n" << tt << std::endl;
+}
+
+const header_costs&
+headers::hdrs() const
+{ return hdrs_; }
+
+const tu_costs&
+headers::tus() const
+{ return tus_; }
+
+void
+headers::add_targets(const zap::targets& ts)
+{
+    for (const auto& p : ts) {
+        add_target(p.second);
+    }
+}
+
+void
+headers::add_target(const zap::target& t)
+{
+    const auto& tc = env().toolchain();
+    zap::string_set sources;
+
+    for (const auto& s : t.sources) {
+        sources.insert(zap::cat_file(t.src_dir, s));
+    }
+
+    for (const auto& fd : t.file_deps) {
+        auto v = g_.add_node(fd.first);
+
+        is_tu_.resize(g_.size(), false);
+
+        if (sources.contains(fd.first)) {
+            is_tu_[v] = true;
+        }
+
+        for (const auto& dep : fd.second) {
+            if (tc.is_std_header(dep)) {
+                continue;
+            }
+
+            auto path = resolve(t, dep);
+
+            if (path != fd.first) {
+                g_.add_edge(v, g_.add_node(path));
+            }
+        }
+    }
+
+    is_tu_.resize(g_.size(), false);
+}
+
+std::string
+headers::resolve(const zap::target& t, const std::string& name) const
+{
+    if (t.has_private_header(name)) {
+        return zap::cat_file(t.src_dir, name);
+    } else if (t.has_public_header(name)) {
+        return zap::cat_file(t.inc_dir, name);
+    }
+
+    const auto* owner = p().headers.find(name);
+
+    if (owner && owner->is_lib() && p().libs.contains(owner->name)) {
+        return zap::cat_file(p().libs.at(owner->name).inc_dir, name);
+    }
+
+    // External header, installed in the environment or not found
+    return name;
+}
+
+std::size_t
+headers::file_size(const std::string& path) const
+{
+    auto size = zap::file_size_if_exists(zap::cat_file(p().root_dir, path));
+
+    if (size == 0) {
+        size = zap::file_size_if_exists(zap::cat_file(env()["include"], path));
+    }
+
+    return size;
+}
+
+void
+headers::compute()
+{
+    auto n = g_.size();
+
+    // Headers get dense indices for the closure bit sets
+    std::vector<std::size_t> hidx(n, 0);
+    csr_graph::node_ids hnodes;
+    std::vector<std::size_t> sizes(n, 0);
+
+    for (csr_graph::node_id v = 0; v < n; ++v) {
+        sizes[v] = file_size(g_.name(v));
+
+        if (!is_tu_[v]) {
+            hidx[v] = hnodes.size();
+            hnodes.push_back(v);
+        }
+    }
+
+    auto h = hnodes.size();
+    std::vector<zap::bit_set> reach(h);
+    auto comps = g_.sccs();
+
+    // Components come dependencies first, members of an include cycle
+    // share the same closure
+    for (std::size_t c = 0; c < comps.size(); ++c) {
+        auto comp = comps[c];
+
+        if (is_tu_[comp.front()]) {
+            continue;
+        }
+
+        zap::bit_set r(h);
+
+        for (auto v : comp) {
+            for (auto w : g_.edges(v)) {
+                if (is_tu_[w]) {
+                    continue;
+                }
+
+                r.set(hidx[w]);
+                r |= reach[hidx[w]];
+            }
+        }
+
+        for (auto v : comp) {
+            reach[hidx[v]] = r;
+        }
+    }
+
+    std::vector<std::size_t> fan_in(h, 0);
+
+    for (csr_graph::node_id v = 0; v < n; ++v) {
+        if (!is_tu_[v]) {
+            continue;
+        }
+
+        zap::bit_set r(h);
+
+        for (auto w : g_.edges(v)) {
+            if (!is_tu_[w]) {
+                r.set(hidx[w]);
+                r |= reach[hidx[w]];
+            }
+        }
+
+        tu_cost tu{ g_.name(v) };
+
+        r.for_each([&](auto i) {
+            ++fan_in[i];
+            tu.bytes += sizes[hnodes[i]];
+        });
+
+        tu.headers = r.count();
+        tus_.emplace_back(std::move(tu));
+    }
+
+    for (std::size_t i = 0; i < h; ++i) {
+        auto v = hnodes[i];
+        header_cost hc{ g_.name(v), sizes[v], sizes[v], fan_in[i] };
+
+        reach[i].for_each([&](auto j) {
+            if (j != i) {
+                hc.pp_size += sizes[hnodes[j]];
+            }
+        });
+
+        hdrs_.emplace_back(std::move(hc));
+    }
+
+    std::stable_sort(
+        hdrs_.begin(), hdrs_.end(),
+        [](const auto& a, const auto& b) { return a.cost() > b.cost(); }
+    );
+
+    std::stable_sort(
+        tus_.begin(), tus_.end(),
+        [](const auto& a, const auto& b) { return a.bytes > b.bytes; }
+    );
+}
+
+}
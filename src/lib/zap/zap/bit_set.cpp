@@ -0,0 +1,73 @@
+#include <algorithm>
+
+#include <zap/bit_set.hpp>
+
+namespace zap {
+
+bit_set::bit_set(std::size_t size)
+{ resize(size); }
+
+bit_set::~bit_set()
+{}
+
+void
+bit_set::resize(std::size_t size)
+{
+    size_ = size;
+    words_.resize((size + word_bits - 1) / word_bits, 0);
+}
+
+void
+bit_set::clear()
+{ std::fill(words_.begin(), words_.end(), 0); }
+
+std::size_t
+bit_set::size() const
+{ return size_; }
+
+std::size_t
+bit_set::count() const
+{
+    std::size_t c = 0;
+
+    for (auto w : words_) {
+        c += std::popcount(w);
+    }
+
+    return c;
+}
+
+bool
+bit_set::none() const
+{
+    return std::all_of(
+        words_.begin(), words_.end(),
+        [](auto w) { return w == 0; }
+    );
+}
+
+void
+bit_set::set(std::size_t i)
+{ words_[i / word_bits] |= word_type{1} << (i % word_bits); }
+
+void
+bit_set::reset(std::size_t i)
+{ words_[i / word_bits] &= ~(word_type{1} << (i % word_bits)); }
+
+bool
+bit_set::test(std::size_t i) const
+{ return (words_[i / word_bits] >> (i % word_bits)) & 1; }
+
+bit_set&
+bit_set::operator|=(const bit_set& other)
+{
+    auto n = std::min(words_.size(), other.words_.size());
+
+    for (std::size_t i = 0; i < n; ++i) {
+        words_[i] |= other.words_[i];
+    }
+
+    return *this;
+}
+
+}
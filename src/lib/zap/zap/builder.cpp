@@ -22,21 +22,41 @@ builder_base::~builder_base()
 builder::builder(
     const zap::env& e,
     const archive_info& ai,
-    const strings& args
+    const strings& args,
+    const std::string& type
 )
+: type_(type.empty() ? detect(ai.source_dir) : type)
 {
-    if (file_exists(cat_file(ai.source_dir, "CMakeLists.txt"))) {
+    if (type_ == "cmake") {
         bp_ = std::make_unique<zap::builders::cmake>(e, ai, args);
-    } else if (file_exists(cat_file(ai.source_dir, "configure"))) {
+    } else if (type_ == "autotools") {
         bp_ = std::make_unique<zap::builders::autotools>(e, ai, args);
     } else {
-        die("unknown build system in dir: ", ai.source_dir);
+        die("unknown build system: ", type_);
     }
 }
 
 builder::~builder()
 {}
 
+std::string
+builder::detect(const std::string& source_dir)
+{
+    if (file_exists(cat_file(source_dir, "CMakeLists.txt"))) {
+        return "cmake";
+    } else if (file_exists(cat_file(source_dir, "configure"))) {
+        return "autotools";
+    }
+
+    die("unknown build system in dir: ", source_dir);
+
+    return {};
+}
+
+const std::string&
+builder::type() const
+{ return type_; }
+
 void
 builder::configure() const
 { bp_->configure(); }
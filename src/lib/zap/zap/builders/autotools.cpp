@@ -1,5 +1,7 @@
 #include <zap/builders/autotools.hpp>
 #include <zap/utils.hpp>
+#include <zap/log.hpp>
+#include <zap/package/installer.hpp>
 
 namespace zap::builders {
 
@@ -13,6 +15,11 @@ autotools::autotools(
     make_.cmd = zap::find_cmd("make");
     build_dir_ = cat_dir(ai.dir, "build");
     stage_dir_ = cat_dir(ai.dir, "stage");
+    cache_file_ = cat_file(
+        e["etc"],
+        "autotools",
+        cat("config-", e.toolchain().fingerprint(), ".cache")
+    );
 }
 
 autotools::~autotools()
@@ -23,27 +30,66 @@ autotools::configure() const
 {
     zap::mkpath(build_dir_);
 
-    zap::call_in_directory(
-        build_dir_,
-        [&] {
-            zap::prog config{ zap::cat_file(ai_.source_dir, "configure") };
-
-            config.run({
-                .args = {
-                    zap::cat("--prefix=", e_["root"]),
-                    "--enable-shared"
-                },
-                .env = e_.build_env()
-            });
+    prepare_cache();
+
+    // Concurrent configures (zap sync -j, other zap runs) each work on
+    // their own copy of the shared cache, configure rewrites it in place
+    auto cache = zap::cat_file(build_dir_, "config.cache");
+
+    if (zap::file_exists(cache)) {
+        zap::rmfile(cache);
+    }
+
+    if (zap::file_exists(cache_file_) && !zap::copy_file(cache_file_, cache)) {
+        zap::warn("failed to copy ", cache_file_, ", configuring without");
+    }
+
+    auto run = [&] {
+        zap::call_in_directory(
+            build_dir_,
+            [&] {
+                zap::prog config{ zap::cat_file(ai_.source_dir, "configure") };
+
+                config.run({
+                    .args = {
+                        zap::cat("--prefix=", e_["root"]),
+                        zap::cat("--cache-file=", cache),
+                        "--enable-shared"
+                    },
+                    .env = e_.build_env()
+                });
+            }
+        );
+    };
+
+    try {
+        run();
+    } catch (const std::exception& ex) {
+        // Packages can disagree on cached values (e.g. a variable set
+        // from different arguments), retry once with a fresh cache
+        zap::warn("configure failed, retrying without cache: ", ex.what());
+
+        if (zap::file_exists(cache)) {
+            zap::rmfile(cache);
         }
-    );
+
+        run();
+    }
+
+    // Published atomically: readers get the previous or the new cache,
+    // work directories are built by one run at a time
+    auto tmp = zap::cat(cache_file_, '.', zap::basename(ai_.dir));
+
+    if (zap::file_exists(cache) && zap::copy_file(cache, tmp)) {
+        zap::rename(tmp, cache_file_);
+    }
 }
 
 void
 autotools::build() const
 {
     make_.run({
-        .args = { "-C", build_dir_ },
+        .args = { "-C", build_dir_, zap::cat("-j", e_.jobs()) },
         .env = e_.build_env()
     });
 }
@@ -59,6 +105,28 @@ autotools::install(zap::package::manifest& pm) const
         },
         .env = e_.build_env()
     });
+
+    // Note: env root starts with a '/'
+    zap::package::installer(e_).install(zap::cat(stage_dir_, e_["root"]), pm);
+}
+
+void
+autotools::prepare_cache() const
+{
+    auto cache_dir = zap::dirname(cache_file_);
+    auto name = zap::basename(cache_file_);
+
+    zap::mkpath(cache_dir);
+
+    // A toolchain change gives a new fingerprint, results of previous
+    // toolchains are no longer of any use
+    auto files = zap::find_files(cache_dir, R"(config-.*\.cache)");
+
+    for (const auto& file : files) {
+        if (zap::basename(file) != name) {
+            zap::rmfile(zap::cat_file(cache_dir, file));
+        }
+    }
 }
 
 }
@@ -1,9 +1,13 @@
-#include <thread>
+#include <re2/re2.h>
 
 #include <zap/builders/cmake.hpp>
 #include <zap/utils.hpp>
+#include <zap/log.hpp>
 #include <zap/cmake/trace_parser.hpp>
+#include <zap/cmake/fileapi_parser.hpp>
+#include <zap/cmake/probe_cache.hpp>
 #include <zap/cmake/toolchain_file.hpp>
+#include <zap/package/installer.hpp>
 
 namespace zap::builders {
 
@@ -18,6 +22,8 @@ cmake::cmake(
     build_dir_ = zap::cat_dir(ai.dir, "build");
     stage_dir_ = zap::cat_dir(ai.dir, "stage");
     trace_file_ = zap::cat_file(build_dir_, "zap-trace.json");
+
+    find_version();
 }
 
 cmake::~cmake()
@@ -43,27 +49,52 @@ cmake::configure() const
         zap::cat("-DCMAKE_TOOLCHAIN_FILE=", toolchain_file),
         "-S", ai_.source_dir,
         "-B", build_dir_,
-        "-G", "Ninja",
-        "-Wno-dev", // trace mode vomits...
-        "--trace-expand",
-        zap::cat("--trace-redirect=", trace_file_),
-        "--trace-format=json-v1"
+        "-G", "Ninja"
     };
 
+    if (use_fileapi()) {
+        zap::cmake::fileapi_parser::write_query(build_dir_);
+    } else {
+        args.insert(
+            args.end(),
+            {
+                "-Wno-dev", // trace mode vomits...
+                "--trace-expand",
+                zap::cat("--trace-redirect=", trace_file_),
+                "--trace-format=json-v1"
+            }
+        );
+    }
+
+    zap::cmake::probe_cache pc(e_);
+
+    if (pc.exists()) {
+        args.insert(args.begin(), { "-C", pc.file() });
+    }
+
     if (!args_.empty()) {
         args.insert(args.end(), args_.begin(), args_.end());
     }
 
     cmake_.run({ .args = args });
+
+    pc.record(zap::cat_file(build_dir_, "CMakeCache.txt"));
 }
 
 void
 cmake::build() const
 {
+    // Nothing to compile but tests and examples, install only needs the
+    // configured project
+    if (header_only()) {
+        zap::log(ai_.name, " is header-only, skipping build");
+        return;
+    }
+
     cmake_.run({
         .args = {
             "--build", build_dir_,
-            "--parallel", std::to_string(std::thread::hardware_concurrency())
+            "--parallel", std::to_string(e_.jobs())
         }
     });
 }
@@ -76,18 +107,54 @@ cmake::install(zap::package::manifest& pm) const
         .env = { { "DESTDIR", stage_dir_ } }
     });
 
-    zap::cmake::trace_parser tp(e_.toolchain());
+    // Note: env root starts with a '/'
+    auto inst_dir = zap::cat(stage_dir_, e_["root"]);
 
-    tp.parse(ai_.source_dir, trace_file_);
+    if (use_fileapi()) {
+        zap::cmake::fileapi_parser fp(e_.toolchain());
 
-    // Note: env root starts with a '/'
-    tp.post_install(zap::cat(stage_dir_, e_["root"]));
+        fp.parse(ai_.source_dir, build_dir_);
+        fp.post_install(inst_dir);
+    } else {
+        zap::cmake::trace_parser tp(e_.toolchain(), e_.executor());
 
-    std::cout << "WHOAA" << std::endl;
+        tp.parse(ai_.source_dir, trace_file_);
+        tp.post_install(inst_dir);
+    }
+
+    zap::package::installer(e_).install(inst_dir, pm);
 }
 
 const std::string&
 cmake::trace_file() const
 { return trace_file_; }
 
+bool
+cmake::use_fileapi() const
+{ return zap::cmake::fileapi_parser::supported(major_, minor_); }
+
+bool
+cmake::header_only() const
+{
+    if (!use_fileapi()) {
+        return false;
+    }
+
+    zap::cmake::fileapi_parser fp(e_.toolchain());
+
+    return fp.header_only(build_dir_);
+}
+
+void
+cmake::find_version()
+{
+    static const re2::RE2 version_re(R"(cmake version (\d+)\.(\d+).*)");
+
+    auto line = cmake_.get_line({ .args = { "--version" } });
+
+    if (!re2::RE2::FullMatch(line, version_re, &major_, &minor_)) {
+        zap::warn("unknown CMake version, falling back to tracing");
+    }
+}
+
 }
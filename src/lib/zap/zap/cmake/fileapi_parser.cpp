@@ -0,0 +1,323 @@
+#include <algorithm>
+#include <unordered_map>
+
+#include <zap/cmake/fileapi_parser.hpp>
+#include <zap/utils.hpp>
+#include <zap/file_utils.hpp>
+#include <zap/files.hpp>
+#include <zap/log.hpp>
+
+namespace zap::cmake {
+
+static const std::string api_dir = ".cmake/api/v1";
+
+fileapi_parser::fileapi_parser(const zap::toolchain& tc)
+: tc_(tc),
+hdr_re_(zap::re(zap::re_type::hdr))
+{}
+
+fileapi_parser::~fileapi_parser()
+{}
+
+bool
+fileapi_parser::supported(std::size_t major, std::size_t minor)
+{ return major > 3 || (major == 3 && minor >= 14); }
+
+void
+fileapi_parser::write_query(const std::string& build_dir)
+{
+    // Stateless query, an empty file named after the requested object
+    auto query = zap::cat_file(build_dir, api_dir, "query", "codemodel-v2");
+
+    zap::mkfilepath(query);
+
+    die_unless(zap::touch_file(query), "failed to write ", query);
+}
+
+void
+fileapi_parser::parse(
+    const std::string& src_dir,
+    const std::string& build_dir
+)
+{
+    src_dir_ = zap::fullpath(src_dir);
+    reply_dir_ = zap::cat_dir(zap::fullpath(build_dir), api_dir, "reply");
+
+    p_.clear();
+    p_.dir = src_dir_;
+
+    auto cm = read_reply(find_codemodel());
+    const auto& configs = cm["configurations"];
+
+    die_if(configs.empty(), "no configuration in CMake code model");
+
+    fileapi_targets fts;
+    std::unordered_map<std::string, std::size_t> ids;
+
+    // Single-config generators (Ninja) have exactly one
+    for (const auto& t : configs[0]["targets"]) {
+        fileapi_target ft;
+
+        if (parse_target(read_reply(t["jsonFile"].get<std::string>()), ft)) {
+            ids.try_emplace(ft.id, fts.size());
+            fts.emplace_back(std::move(ft));
+        }
+    }
+
+    // Compile groups also hold the include directories propagated by
+    // dependencies, these belong to the dependencies
+    for (auto& ft : fts) {
+        zap::string_set excluded;
+
+        for (const auto& dep : ft.deps) {
+            auto it = ids.find(dep);
+
+            if (it != ids.end()) {
+                const auto& incs = fts[it->second].includes;
+
+                excluded.insert(incs.begin(), incs.end());
+            }
+        }
+
+        add_target(ft, excluded);
+    }
+}
+
+void
+fileapi_parser::post_install(const std::string& inst_dir)
+{
+    inst_dir_ = zap::fullpath(inst_dir);
+
+    p_.clean_libraries(inst_dir_);
+}
+
+bool
+fileapi_parser::header_only(const std::string& build_dir)
+{
+    // Dashboard targets added by include(CTest)
+    static const re2::RE2 ctest_re(
+        R"((?:Continuous|Experimental|Nightly)\w*)"
+    );
+
+    reply_dir_ = zap::cat_dir(zap::fullpath(build_dir), api_dir, "reply");
+
+    auto cm = read_reply(find_codemodel());
+    const auto& configs = cm["configurations"];
+
+    if (configs.empty()) {
+        return false;
+    }
+
+    for (const auto& t : configs[0]["targets"]) {
+        auto j = read_reply(t["jsonFile"].get<std::string>());
+        auto type = j.value("type", "");
+        auto name = j.value("name", "");
+
+        if (
+            (type != "INTERFACE_LIBRARY" && j.contains("install"))
+            ||
+            // Custom targets may generate installed files
+            (type == "UTILITY" && !re2::RE2::FullMatch(name, ctest_re))
+        ) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+const zap::cmake::project&
+fileapi_parser::project() const
+{ return p_; }
+
+fileapi_parser::json
+fileapi_parser::read_reply(const std::string& file) const
+{
+    auto path = zap::cat_file(reply_dir_, file);
+    auto j = json::parse(zap::slurp(path), nullptr, false);
+
+    die_if(j.is_discarded(), "invalid CMake File API reply: ", path);
+
+    return j;
+}
+
+std::string
+fileapi_parser::find_codemodel() const
+{
+    auto indexes = zap::find_files(reply_dir_, R"(index-.*\.json)");
+
+    die_if(indexes.empty(), "no CMake File API reply in ", reply_dir_);
+
+    // Index files are named after their creation time, the latest wins
+    std::sort(indexes.begin(), indexes.end());
+
+    auto index = read_reply(indexes.back());
+    const auto& reply = index["reply"];
+
+    die_unless(
+        reply.contains("codemodel-v2"),
+        "no codemodel-v2 in CMake File API reply"
+    );
+
+    return reply["codemodel-v2"]["jsonFile"].get<std::string>();
+}
+
+bool
+fileapi_parser::parse_target(const json& t, fileapi_target& ft) const
+{
+    auto type = t.value("type", "");
+
+    // Same as trace_parser: OBJECT and MODULE libraries are ignored,
+    // IMPORTED ones aren't part of the code model
+    if (
+        type != "STATIC_LIBRARY"
+        &&
+        type != "SHARED_LIBRARY"
+        &&
+        type != "INTERFACE_LIBRARY"
+    ) {
+        return false;
+    }
+
+    ft.id = t["id"].get<std::string>();
+    ft.name = t["name"].get<std::string>();
+
+    for (const auto& dep : t.value("dependencies", json::array())) {
+        ft.deps.push_back(dep["id"].get<std::string>());
+    }
+
+    // File sets (CMake 3.23+) tell exactly which headers are public
+    std::unordered_map<std::size_t, std::string> set_dirs;
+
+    if (t.contains("fileSets")) {
+        const auto& fss = t["fileSets"];
+
+        for (std::size_t i = 0; i < fss.size(); ++i) {
+            const auto& fs = fss[i];
+
+            if (
+                fs.value("type", "") != "HEADERS"
+                ||
+                fs.value("visibility", "") == "PRIVATE"
+                ||
+                fs["baseDirectories"].empty()
+            ) {
+                continue;
+            }
+
+            auto base = zap::fullpath(
+                src_dir_,
+                fs["baseDirectories"][0].get<std::string>()
+            );
+
+            set_dirs.try_emplace(i, base);
+
+            if (ft.interface_dir.empty()) {
+                ft.interface_dir = base;
+                ft.from_file_sets = true;
+            }
+        }
+    }
+
+    for (const auto& s : t.value("sources", json::array())) {
+        auto path = zap::fullpath(src_dir_, s["path"].get<std::string>());
+
+        if (!re2::RE2::FullMatch(path, hdr_re_)) {
+            continue;
+        }
+
+        if (s.contains("fileSetIndex")) {
+            auto it = set_dirs.find(s["fileSetIndex"].get<std::size_t>());
+
+            if (it != set_dirs.end()) {
+                ft.headers.insert(relative(path, it->second));
+            }
+        } else if (set_dirs.empty()) {
+            ft.headers.insert(path);
+        }
+    }
+
+    for (const auto& cg : t.value("compileGroups", json::array())) {
+        for (const auto& inc : cg.value("includes", json::array())) {
+            auto dir = inc["path"].get<std::string>();
+
+            if (
+                !inc.value("isSystem", false)
+                &&
+                !relative(dir, src_dir_).starts_with('/')
+            ) {
+                ft.includes.push_back(std::move(dir));
+            }
+        }
+    }
+
+    return true;
+}
+
+void
+fileapi_parser::add_target(
+    fileapi_target& ft,
+    const zap::string_set& excluded
+)
+{
+    auto& siface = ft.interface_dir;
+
+    if (!ft.from_file_sets) {
+        // Without file sets, pick the target's own include directory
+        // looking most like a public one
+        for (const auto& dir : ft.includes) {
+            if (excluded.contains(dir)) {
+                continue;
+            }
+
+            if (siface.empty() || zap::basename(dir) == "include") {
+                siface = dir;
+            }
+        }
+    }
+
+    zap::files headers;
+
+    for (const auto& h : ft.headers) {
+        if (!h.starts_with('/')) {
+            // Already relative to its file set
+            headers.insert(h);
+        } else if (!siface.empty() && !relative(h, siface).starts_with('/')) {
+            headers.insert(relative(h, siface));
+        } else {
+            headers.insert(relative(h, src_dir_));
+        }
+    }
+
+    if (!ft.from_file_sets && !siface.empty()) {
+        zap::add_files(headers, siface, zap::re(zap::re_type::hdr));
+    }
+
+    p_.add_library(ft.name);
+    p_.add_headers(ft.name, headers);
+
+    // Install interface directories aren't part of the code model,
+    // post_install() drops headers not found there
+    p_.set_interface_dirs(ft.name, siface, "include");
+}
+
+std::string
+fileapi_parser::relative(
+    const std::string& path,
+    const std::string& dir
+) const
+{
+    if (
+        path.size() > dir.size()
+        &&
+        path.starts_with(dir)
+        &&
+        path[dir.size()] == '/'
+    ) {
+        return path.substr(dir.size() + 1);
+    }
+
+    return path;
+}
+
+}
@@ -0,0 +1,151 @@
+#include <fstream>
+
+#include <unistd.h>
+
+#include <re2/re2.h>
+
+#include <zap/cmake/probe_cache.hpp>
+#include <zap/utils.hpp>
+#include <zap/log.hpp>
+
+namespace zap::cmake {
+
+probe_cache::probe_cache(const zap::env& e)
+: env_(e),
+fingerprint_(e.toolchain().fingerprint()),
+file_(
+    zap::cat_file(
+        e["etc"],
+        "cmake",
+        zap::cat("probes-", fingerprint_, ".cmake")
+    )
+)
+{}
+
+probe_cache::~probe_cache()
+{}
+
+const std::string&
+probe_cache::file() const
+{ return file_; }
+
+bool
+probe_cache::exists() const
+{ return zap::file_exists(file_); }
+
+void
+probe_cache::record(const std::string& cache_file) const
+{
+    // NAME:TYPE=VALUE
+    static const re2::RE2 entry_re(R"(([A-Za-z_][A-Za-z0-9_]*):INTERNAL=(.*))");
+
+    std::ifstream ifs(cache_file);
+
+    if (!ifs) {
+        return;
+    }
+
+    entries found;
+    std::string name;
+    std::string value;
+
+    for (std::string line; std::getline(ifs, line); ) {
+        if (
+            re2::RE2::FullMatch(line, entry_re, &name, &value)
+            &&
+            allowed(name, value)
+        ) {
+            found.insert_or_assign(name, value);
+        }
+    }
+
+    if (found.empty()) {
+        return;
+    }
+
+    // Parallel package builds and other zap runs share the seed file
+    auto l = env_.lock("probes", fingerprint_);
+
+    auto es = read_seed();
+    auto count = es.size();
+
+    es.merge(found);
+
+    if (es.size() != count) {
+        write_seed(es);
+    }
+}
+
+bool
+probe_cache::allowed(const std::string& name, const std::string& value)
+{
+    // Headers, functions, symbols and type sizes from the standard check
+    // modules. Library checks depend on what the env holds.
+    static const re2::RE2 allow_re(
+        R"((?:CMAKE_)?HAVE_[A-Z0-9_]+|SIZEOF_[A-Z0-9_]+)"
+    );
+    static const re2::RE2 deny_re(R"((?:CMAKE_)?HAVE_LIB[A-Z0-9_]*)");
+    static const re2::RE2 value_re(R"([A-Za-z0-9_]+)");
+    static const re2::RE2 negative_re(
+        R"((?i)0|false|off|no|n|ignore|notfound)"
+    );
+
+    return
+        re2::RE2::FullMatch(name, allow_re)
+        &&
+        !re2::RE2::FullMatch(name, deny_re)
+        &&
+        re2::RE2::FullMatch(value, value_re)
+        &&
+        !re2::RE2::FullMatch(value, negative_re)
+        ;
+}
+
+probe_cache::entries
+probe_cache::read_seed() const
+{
+    static const re2::RE2 set_re(
+        R"re(set\(([A-Za-z0-9_]+) "(.*)" CACHE INTERNAL ""\))re"
+    );
+
+    entries es;
+    std::ifstream ifs(file_);
+    std::string name;
+    std::string value;
+
+    for (std::string line; std::getline(ifs, line); ) {
+        if (re2::RE2::FullMatch(line, set_re, &name, &value)) {
+            es.emplace(name, value);
+        }
+    }
+
+    return es;
+}
+
+void
+probe_cache::write_seed(const entries& es) const
+{
+    auto tmp_file = zap::cat(file_, '.', ::getpid(), ".tmp");
+
+    zap::mkfilepath(file_);
+
+    {
+        std::ofstream ofs(tmp_file, std::ios::trunc);
+
+        die_unless(ofs.good(), "failed to open ", tmp_file);
+
+        ofs << "# Feature probe results recorded by zap\n";
+
+        for (const auto& [ name, value ] : es) {
+            ofs
+                << "set(" << name << " \"" << value << "\""
+                << " CACHE INTERNAL \"\")\n"
+                ;
+        }
+    }
+
+    // Configures running meanwhile only ever see a complete file
+    zap::rename(tmp_file, file_);
+}
+
+}
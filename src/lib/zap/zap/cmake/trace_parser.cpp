@@ -1,17 +1,15 @@
-#include <iostream>
-#include <sstream>
-
-#include <nlohmann/json.hpp>
+#include <algorithm>
+#include <cctype>
+#include <charconv>
 
 #include <zap/cmake/trace_parser.hpp>
+#include <zap/mapped_file.hpp>
 #include <zap/utils.hpp>
 #include <zap/file_utils.hpp>
 #include <zap/log.hpp>
 
 namespace zap::cmake {
 
-using json = nlohmann::json;
-
 ///////////////////////////////////////////////////////////////////////////////
 //
 // Utilities
@@ -27,6 +25,304 @@ template <typename T, typename U>
 auto extract(const std::pair<T, U>& p)
 { return p.first; }
 
+static constexpr std::string_view cmd_key = "\"cmd\":\"";
+
+// Only lines of these commands are parsed
+static constexpr std::string_view wanted_cmds[] = {
+    "add_subdirectory",
+    "add_library",
+    "target_include_directories",
+    "target_link_libraries",
+    "target_sources"
+};
+
+// Minimal JSON scanner for json-v1 trace lines
+//
+// Strings without escapes are returned as views of the line, the others
+// are decoded into the chunk arena. Only the fields zap needs are kept.
+using arg_range = std::pair<std::size_t, std::size_t>;
+using arg_ranges = std::vector<arg_range>;
+
+class line_scanner
+{
+public:
+    line_scanner(std::string_view line, trace_chunk& c, arg_ranges& ranges)
+    : s_(line),
+    c_(c),
+    ranges_(ranges)
+    {}
+
+    void scan()
+    {
+        cmd cmd;
+        std::size_t args_pos = c_.args.size();
+        std::size_t args_count = 0;
+
+        expect('{');
+
+        while (!peek('}')) {
+            auto key = string();
+
+            expect(':');
+
+            if (key == "args") {
+                expect('[');
+
+                while (!peek(']')) {
+                    c_.args.push_back(string());
+                    ++args_count;
+                    skip(',');
+                }
+
+                expect(']');
+            } else if (key == "cmd") {
+                cmd.name = string();
+            } else if (key == "file") {
+                cmd.file = string();
+            } else if (key == "frame") {
+                cmd.frame = number();
+            } else {
+                skip_value();
+            }
+
+            skip(',');
+        }
+
+        expect('}');
+
+        if (args_count > 0) {
+            cmd.subject = c_.args[args_pos];
+        }
+
+        // Arguments live in c_.args, spans are set once the chunk is done
+        // as the vector may grow meanwhile
+        c_.cmds.push_back(cmd);
+        ranges_.emplace_back(args_pos, args_count);
+    }
+
+private:
+    void ws()
+    {
+        while (i_ < s_.size() && std::isspace(s_[i_])) {
+            ++i_;
+        }
+    }
+
+    bool peek(char c)
+    {
+        ws();
+
+        return i_ < s_.size() && s_[i_] == c;
+    }
+
+    void skip(char c)
+    {
+        if (peek(c)) {
+            ++i_;
+        }
+    }
+
+    void expect(char c)
+    {
+        die_unless(peek(c), "invalid trace line: ", s_);
+
+        ++i_;
+    }
+
+    std::string_view string()
+    {
+        expect('"');
+
+        auto begin = i_;
+        bool escaped = false;
+
+        while (i_ < s_.size() && s_[i_] != '"') {
+            if (s_[i_] == '\\') {
+                escaped = true;
+                ++i_;
+            }
+
+            ++i_;
+        }
+
+        die_unless(i_ < s_.size(), "invalid trace line: ", s_);
+
+        auto raw = s_.substr(begin, i_ - begin);
+
+        ++i_;
+
+        return escaped ? unescape(raw) : raw;
+    }
+
+    std::string_view unescape(std::string_view raw)
+    {
+        auto& out = c_.arena.emplace_back();
+
+        out.reserve(raw.size());
+
+        for (std::size_t i = 0; i < raw.size(); ++i) {
+            if (raw[i] != '\\' || i + 1 == raw.size()) {
+                out += raw[i];
+                continue;
+            }
+
+            switch (raw[++i]) {
+                case 'b': out += '\b'; break;
+                case 'f': out += '\f'; break;
+                case 'n': out += '\n'; break;
+                case 'r': out += '\r'; break;
+                case 't': out += '\t'; break;
+                case 'u': i = unicode(raw, i, out); break;
+                default: out += raw[i]; break;
+            }
+        }
+
+        return out;
+    }
+
+    std::size_t
+    unicode(std::string_view raw, std::size_t i, std::string& out)
+    {
+        auto hex = [&](std::size_t pos) {
+            std::uint32_t cp = 0;
+
+            die_unless(pos + 4 <= raw.size(), "invalid trace line: ", s_);
+
+            auto last = raw.data() + pos + 4;
+            auto [ ptr, ec ] = std::from_chars(raw.data() + pos, last, cp, 16);
+
+            die_unless(
+                ec == std::errc() && ptr == last,
+                "invalid trace line: ", s_
+            );
+
+            return cp;
+        };
+
+        auto cp = hex(i + 1);
+
+        i += 4;
+
+        if (
+            cp >= 0xd800 && cp < 0xdc00
+            &&
+            i + 6 < raw.size() && raw[i + 1] == '\\' && raw[i + 2] == 'u'
+        ) {
+            // Surrogate pair
+            cp = 0x10000 + ((cp - 0xd800) << 10) + (hex(i + 3) - 0xdc00);
+            i += 6;
+        }
+
+        if (cp < 0x80) {
+            out += char(cp);
+        } else if (cp < 0x800) {
+            out += char(0xc0 | (cp >> 6));
+            out += char(0x80 | (cp & 0x3f));
+        } else if (cp < 0x10000) {
+            out += char(0xe0 | (cp >> 12));
+            out += char(0x80 | ((cp >> 6) & 0x3f));
+            out += char(0x80 | (cp & 0x3f));
+        } else {
+            out += char(0xf0 | (cp >> 18));
+            out += char(0x80 | ((cp >> 12) & 0x3f));
+            out += char(0x80 | ((cp >> 6) & 0x3f));
+            out += char(0x80 | (cp & 0x3f));
+        }
+
+        return i;
+    }
+
+    std::size_t number()
+    {
+        ws();
+
+        std::size_t n = 0;
+        auto [ ptr, ec ] = std::from_chars(
+            s_.data() + i_,
+            s_.data() + s_.size(),
+            n
+        );
+
+        die_unless(ec == std::errc(), "invalid trace line: ", s_);
+
+        i_ = ptr - s_.data();
+
+        return n;
+    }
+
+    void skip_value()
+    {
+        ws();
+
+        die_unless(i_ < s_.size(), "invalid trace line: ", s_);
+
+        if (s_[i_] == '"') {
+            string();
+        } else if (s_[i_] == '[' || s_[i_] == '{') {
+            auto close = s_[i_] == '[' ? ']' : '}';
+
+            ++i_;
+
+            while (!peek(close)) {
+                if (close == '}') {
+                    string();
+                    expect(':');
+                }
+
+                skip_value();
+                skip(',');
+            }
+
+            ++i_;
+        } else {
+            // Numbers, booleans and null
+            while (
+                i_ < s_.size()
+                &&
+                s_[i_] != ',' && s_[i_] != '}' && s_[i_] != ']'
+            ) {
+                ++i_;
+            }
+        }
+    }
+
+    std::string_view s_;
+    trace_chunk& c_;
+    arg_ranges& ranges_;
+    std::size_t i_ = 0;
+};
+
+// Splits text in about count chunks of whole lines
+trace_chunks
+split_chunks(std::string_view text, std::size_t count)
+{
+    // Below this, splitting costs more than it brings
+    static constexpr std::size_t min_chunk_size = 4 * 1024 * 1024;
+
+    count = std::max<std::size_t>(
+        1,
+        std::min(count, text.size() / min_chunk_size)
+    );
+
+    trace_chunks chunks(count);
+    auto chunk_size = text.size() / count;
+    std::size_t begin = 0;
+
+    for (std::size_t i = 0; i < count; ++i) {
+        auto end = text.size();
+
+        if (i + 1 < count) {
+            end = text.find('\n', std::max(begin, (i + 1) * chunk_size));
+            end = end == std::string_view::npos ? text.size() : end + 1;
+        }
+
+        chunks[i].text = text.substr(begin, end - begin);
+        begin = end;
+    }
+
+    return chunks;
+}
+
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -35,16 +331,17 @@ auto extract(const std::pair<T, U>& p)
 //
 ///////////////////////////////////////////////////////////////////////////////
 bool
-cmd::has(const std::string& key) const
-{ return arg_keys.contains(key); }
+cmd::has(std::string_view key) const
+{ return std::find(args.begin(), args.end(), key) != args.end(); }
 
 ///////////////////////////////////////////////////////////////////////////////
 //
 // Trace Parser
 //
 ///////////////////////////////////////////////////////////////////////////////
-trace_parser::trace_parser(const zap::toolchain& tc)
+trace_parser::trace_parser(const zap::toolchain& tc, zap::executor& exec)
 : tc_(tc),
+exec_(exec),
 hdr_re_(zap::re(zap::re_type::hdr)),
 build_interface_{ "$<BUILD_INTERFACE:" },
 install_interface_{ "$<INSTALL_INTERFACE:" }
@@ -63,32 +360,94 @@ trace_parser::parse(
 
     p_.clear();
     p_.dir = src_dir_;
+    subdir_.clear();
+    seen_libs_.clear();
+    deps_.clear();
+    rev_deps_.clear();
+
+    zap::mapped_file mf(trace_file);
+    auto chunks = detail::split_chunks(mf.view(), exec_.num_workers());
+
+    // Chunks are scanned in parallel, commands are then applied in trace
+    // order as some state (subdir_) depends on preceding commands
+    auto cb = [&](std::size_t, std::size_t i) { scan(chunks[i]); };
 
-    std::ifstream ifs(trace_file);
-
-    auto asd = make_cmd("add_subdirectory");
-    auto al = make_cmd("add_library");
-    auto tid = make_cmd("target_include_directories");
-    auto tll = make_cmd("target_link_libraries");
-    auto ts = make_cmd("target_sources");
-
-    for (std::string line; std::getline(ifs, line); ) {
-        if (zap::contains(line, asd)) {
-            parse_subdirectory(line);
-        } else if (zap::contains(line, al)) {
-            parse_library(line);
-        } else if (zap::contains(line, tid)) {
-            parse_library_includes(line);
-        } else if (zap::contains(line, tll)) {
-            parse_library_deps(line);
-        } else if (zap::contains(line, ts)) {
-            parse_library_sources(line);
+    {
+        zap::async_pool<decltype(cb)> ap(exec_, cb);
+
+        for (std::size_t i = 0; i < chunks.size(); ++i) {
+            ap.async(i);
+        }
+
+        ap.wait();
+    }
+
+    for (const auto& c : chunks) {
+        for (const auto& cmd : c.cmds) {
+            apply(cmd);
         }
     }
 
     handle_deps();
 }
 
+void
+trace_parser::scan(trace_chunk& c) const
+{
+    detail::arg_ranges ranges;
+    auto text = c.text;
+    std::size_t pos = 0;
+
+    // Non matching lines are never looked at beyond the key search
+    while ((pos = text.find(detail::cmd_key, pos)) != std::string_view::npos) {
+        auto name_pos = pos + detail::cmd_key.size();
+        auto name = text.substr(name_pos, text.find('"', name_pos) - name_pos);
+        auto begin = text.rfind('\n', pos);
+        auto end = text.find('\n', pos);
+
+        begin = begin == std::string_view::npos ? 0 : begin + 1;
+        end = end == std::string_view::npos ? text.size() : end;
+
+        bool wanted = std::find(
+            std::begin(detail::wanted_cmds),
+            std::end(detail::wanted_cmds),
+            name
+        ) != std::end(detail::wanted_cmds);
+
+        if (wanted) {
+            auto line = text.substr(begin, end - begin);
+
+            detail::line_scanner(line, c, ranges).scan();
+        }
+
+        pos = end;
+    }
+
+    for (std::size_t i = 0; i < c.cmds.size(); ++i) {
+        auto [ first, count ] = ranges[i];
+
+        if (count > 1) {
+            c.cmds[i].args = { c.args.data() + first + 1, count - 1 };
+        }
+    }
+}
+
+void
+trace_parser::apply(const cmd& c)
+{
+    if (c.name == "add_subdirectory") {
+        parse_subdirectory(c);
+    } else if (c.name == "add_library") {
+        parse_library(c);
+    } else if (c.name == "target_include_directories") {
+        parse_library_includes(c);
+    } else if (c.name == "target_link_libraries") {
+        parse_library_deps(c);
+    } else if (c.name == "target_sources") {
+        parse_library_sources(c);
+    }
+}
+
 void
 trace_parser::post_install(const std::string& inst_dir)
 {
@@ -116,11 +475,9 @@ trace_parser::project() const
 { return p_; }
 
 void
-trace_parser::parse_subdirectory(const std::string& line)
+trace_parser::parse_subdirectory(const cmd& c)
 {
-    auto cmd = parse_cmd(line);
-
-    std::string_view dirs = cmd.file;
+    auto dirs = c.file;
 
     // Remove "source dir/" and trailing "/CMakeLists.txt"
     // "/CMakeLists.txt" is 15 chars
@@ -128,33 +485,31 @@ trace_parser::parse_subdirectory(const std::string& line)
     dirs.remove_suffix(15);
 
     if (dirs.empty()) {
-        subdir_ = cmd.subject;
+        subdir_ = c.subject;
     } else {
-        subdir_ = zap::cat_dir(dirs, cmd.subject);
+        subdir_ = zap::cat_dir(dirs, c.subject);
     }
 }
 
 void
-trace_parser::parse_library(const std::string& line)
+trace_parser::parse_library(const cmd& c)
 {
-    auto cmd = parse_cmd(line);
-
     // TODO: handle OBJECT case and scan for headers too
-    if (ignore_library(cmd) || cmd.args.empty()) {
+    if (ignore_library(c) || c.args.empty()) {
         return;
     }
 
-    const auto& lib = cmd.subject;
+    std::string lib{ c.subject };
 
     seen_libs_.insert(lib);
 
-    if (cmd.has("ALIAS")) {
-        die_unless(cmd.args.size() == 2, "invalid add_library ALIAS");
+    if (c.has("ALIAS")) {
+        die_unless(c.args.size() == 2, "invalid add_library ALIAS");
 
-        p_.add_alias(lib, cmd.args[1]);
+        p_.add_alias(lib, std::string{ c.args[1] });
     } else {
         // SHARED, STATIC, INTERFACE...
-        die_unless(cmd.args.size() > 0, "invalid add_library");
+        die_unless(c.args.size() > 0, "invalid add_library");
 
         /*zap::link_type lt;
 
@@ -169,22 +524,18 @@ trace_parser::parse_library(const std::string& line)
 
         p_.add_library(lib, lt);*/
 
-        parse_library_sources(lib, cmd.args);
+        parse_library_sources(lib, c.args);
     }
 }
 
 void
-trace_parser::parse_library_sources(const std::string& line)
-{
-    auto cmd = parse_cmd(line);
-
-    parse_library_sources(cmd.subject, cmd.args);
-}
+trace_parser::parse_library_sources(const cmd& c)
+{ parse_library_sources(c.subject, c.args); }
 
 void
 trace_parser::parse_library_sources(
-    const std::string& lib,
-    const zap::strings& args
+    std::string_view lib,
+    std::span<const std::string_view> args
 )
 {
     zap::string_set headers;
@@ -192,7 +543,7 @@ trace_parser::parse_library_sources(
     for (const auto& a : args) {
         for (const auto& file : parse_build_interface(a)) {
             if (re2::RE2::FullMatch(file, hdr_re_)) {
-                std::string_view fv = file;
+                auto fv = file;
 
                 if (fv.starts_with(src_dir_)) {
                     fv.remove_prefix(src_dir_.size() + 1);
@@ -203,17 +554,17 @@ trace_parser::parse_library_sources(
         }
     }
 
-    p_.add_headers(lib, headers);
+    p_.add_headers(std::string{ lib }, headers);
 }
 
 void
-trace_parser::parse_library_includes(const std::string& line)
+trace_parser::parse_library_includes(const cmd& c)
 {
-    auto cmd = parse_cmd(line);
+    std::string lib{ c.subject };
     std::string siface;
     std::string diface = "include";
 
-    for (const auto& a : cmd.args) {
+    for (const auto& a : c.args) {
         if (a.starts_with(build_interface_)) {
             auto dirs = parse_build_interface(a);
             auto inc_dir = zap::fullpath(dirs.front());
@@ -224,27 +575,27 @@ trace_parser::parse_library_includes(const std::string& line)
                 zap::files files;
 
                 zap::add_files(files, inc_dir, zap::re(zap::re_type::hdr));
-                p_.add_headers(cmd.subject, files);
+                p_.add_headers(lib, files);
             }
         } else if (a.starts_with(install_interface_)) {
             auto dirs = parse_install_interface(a);
 
             if (!dirs.empty()) {
-                diface = dirs.front();
+                diface = std::string{ dirs.front() };
             }
         }
     }
 
-    p_.set_interface_dirs(cmd.subject, siface, diface);
+    p_.set_interface_dirs(lib, siface, diface);
 }
 
 void
-trace_parser::parse_library_deps(const std::string& line)
+trace_parser::parse_library_deps(const cmd& c)
 {
-    auto cmd = parse_cmd(line);
-    auto& lib_deps = deps_[cmd.subject];
+    std::string lib{ c.subject };
+    auto& lib_deps = deps_[lib];
 
-    for (const auto& a : cmd.args) {
+    for (const auto& a : c.args) {
         if (not_a_library(a)) {
             continue;
         }
@@ -255,14 +606,14 @@ trace_parser::parse_library_deps(const std::string& line)
         for (const auto& depv : zap::split(";", a)) {
             std::string dep(depv.data(), depv.size());
 
-            rev_deps_[dep].insert(cmd.subject);
+            rev_deps_[dep].insert(lib);
             lib_deps.insert(std::move(dep));
         }
     }
 }
 
 bool
-trace_parser::not_a_library(const std::string& s) const
+trace_parser::not_a_library(std::string_view s) const
 {
     return
         s.empty()
@@ -279,20 +630,20 @@ trace_parser::not_a_library(const std::string& s) const
 }
 
 zap::string_views
-trace_parser::parse_build_interface(const std::string& s) const
+trace_parser::parse_build_interface(std::string_view s) const
 { return parse_interface(s, build_interface_); }
 
 zap::string_views
-trace_parser::parse_install_interface(const std::string& s) const
+trace_parser::parse_install_interface(std::string_view s) const
 { return parse_interface(s, install_interface_); }
 
 zap::string_views
 trace_parser::parse_interface(
-    const std::string& s,
+    std::string_view s,
     const std::string_view& interface
 ) const
 {
-    std::string_view list = s;
+    auto list = s;
 
     if (list.starts_with(interface)) {
         list.remove_prefix(interface.size());
@@ -306,40 +657,4 @@ bool
 trace_parser::ignore_library(const cmd& c) const
 { return c.has("IMPORTED") || c.has("OBJECT") || c.has("MODULE"); }
 
-cmd
-trace_parser::parse_cmd(const std::string& line) const
-{
-    cmd c;
-
-    auto l = json::parse(line);
-    bool first = true;
-
-    for (const auto& arg : l["args"]) {
-        auto a = arg.get<std::string>();
-
-        if (first) {
-            c.subject = std::move(a);
-            first = false;
-        } else {
-            c.arg_keys.insert(a);
-            c.args.emplace_back(std::move(a));
-        }
-    }
-
-    c.file = l["file"].get<std::string>();
-    c.frame = l["frame"].get<std::size_t>();
-
-    return c;
-}
-
-std::string
-trace_parser::make_cmd(const std::string& cmd) const
-{
-    std::ostringstream oss;
-
-    oss <<  "\"cmd\":" << '"' << cmd << '"';
-
-    return oss.str();
-}
-
 }
@@ -1,8 +1,10 @@
 #include <zap/commands/analyze.hpp>
-#include <zap/builders/cmake.hpp>
-#include <zap/cmake/trace_parser.hpp>
-#include <zap/scope.hpp>
-#include <zap/zapfile.hpp>
+#include <zap/project_scanner.hpp>
+#include <zap/link_reducer.hpp>
+#include <zap/analyzers/headers.hpp>
+#include <zap/analyzers/build_time.hpp>
+#include <zap/analyzers/critical_path.hpp>
+#include <zap/text/table.hpp>
 #include <zap/utils.hpp>
 
 namespace zap::commands {
@@ -18,34 +20,76 @@ analyze::~analyze()
 void
 analyze::operator()()
 {
-    zapfile zf;
+    zap::project_scanner ps(env(), p_);
 
-    zf.load();
+    ps.find_targets(zap::fullpath(opts_.directory));
 
-    return;
+    // Only the target model is needed to attribute build times
+    if (!opts_.build_dir.empty()) {
+        analyze_build_time();
+        return;
+    } else if (!opts_.ninja_dir.empty()) {
+        analyze_critical_path();
+        return;
+    }
 
-    zap::scope s;
+    ps.scan_targets();
 
-    auto tmp = zap::empty_temp_dir("/tmp");
+    analyze_links();
+    analyze_headers();
+}
+
+void
+analyze::analyze_links()
+{
+    zap::link_reducer lr(p_);
+
+    const auto& st = lr.reduce();
+
+    zap::text::table t("link dependencies", "edges");
+
+    t.add_row("discovered", std::to_string(st.before));
+    t.add_row("after transitive reduction", std::to_string(st.after));
+    t.add_row("redundant", std::to_string(st.before - st.after));
+
+    std::cout << t << std::endl;
+}
+
+void
+analyze::analyze_headers()
+{
+    zap::analyzers::headers ha(env(), p_, opts_.top);
+
+    ha.analyze();
+
+    std::cout << "\n";
+    ha.print(std::cout);
+}
 
-    s.push_rmpath(tmp);
+void
+analyze::analyze_build_time()
+{
+    zap::analyzers::build_time bt(env(), p_, opts_.build_dir, opts_.top);
 
-    // TODO: find correct project type instead of CMake default below
-    zap::builders::cmake cm(
-        env(),
-        {
-            .dir = tmp,
-            .source_dir = opts_.directory
-        }
-    );
+    bt.analyze();
+    bt.print(std::cout);
 
-    cm.configure();
+    if (!opts_.json_file.empty()) {
+        bt.write_json(opts_.json_file);
+    }
+}
 
-    zap::cmake::trace_parser tp(env().toolchain());
+void
+analyze::analyze_critical_path()
+{
+    zap::analyzers::critical_path cp(env(), p_, opts_.ninja_dir, opts_.top);
 
-    tp.parse(opts_.directory, cm.trace_file());
+    cp.analyze();
+    cp.print(std::cout);
 
-    std::cout << "analyze done." << std::endl;
+    if (!opts_.json_file.empty()) {
+        cp.write_json(opts_.json_file);
+    }
 }
 
 }
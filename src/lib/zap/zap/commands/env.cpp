@@ -1,6 +1,7 @@
 #include <zap/commands/env.hpp>
 #include <zap/env_db.hpp>
 #include <zap/text/table.hpp>
+#include <zap/utils.hpp>
 #include <zap/log.hpp>
 
 namespace zap::commands {
@@ -29,6 +30,9 @@ env::operator()()
         case env_cmd::ls_pkgs:
         ls_pkgs();
         break;
+        case env_cmd::which:
+        which();
+        break;
     }
 }
 
@@ -91,4 +95,41 @@ env::ls_pkgs()
     std::cout << t << std::endl;
 }
 
+void
+env::which()
+{
+    auto e = command::env().sys_db().get_env(opts_.name);
+
+    zap::env_db edb(e.root);
+
+    // Absolute paths in the env, or relative to its root
+    auto file = opts_.file;
+    auto root = zap::cat(e.root, '/');
+
+    if (file.starts_with(root)) {
+        file = file.substr(root.size());
+    }
+
+    std::string pkg;
+
+    if (!edb.file_owner(file, pkg)) {
+        // Header as written in #include directives
+        file = zap::cat_file("include", opts_.file);
+
+        die_unless(
+            edb.file_owner(file, pkg),
+            "no package installs ", opts_.file
+        );
+    }
+
+    env_db_pkg p;
+
+    die_unless(
+        edb.has_package(pkg, p),
+        opts_.file, " is owned by ", pkg, " which isn't installed"
+    );
+
+    zap::log(file, ": ", p.name, " ", p.version);
+}
+
 }
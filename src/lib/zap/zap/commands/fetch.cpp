@@ -0,0 +1,49 @@
+#include <zap/commands/fetch.hpp>
+#include <zap/prefetcher.hpp>
+#include <zap/package/list.hpp>
+#include <zap/utils.hpp>
+#include <zap/log.hpp>
+
+namespace zap::commands {
+
+fetch::fetch(const zap::env& e, const fetch_opts& opts)
+: zap::command(e),
+opts_(opts)
+{}
+
+fetch::~fetch()
+{}
+
+void
+fetch::operator()()
+{
+    auto urls = opts_.urls;
+    zap::string_map digests;
+
+    if (!opts_.file.empty()) {
+        auto pl = zap::package::load_list(opts_.file);
+
+        urls = zap::package::list_urls(pl);
+        digests = zap::package::list_digests(pl);
+    }
+
+    zap::prefetcher pf(env(), urls, opts_.jobs, true, digests);
+    std::size_t failed = 0;
+
+    for (const auto& url : urls) {
+        try {
+            pf.get(url);
+            zap::log("fetched ", url);
+        } catch (const std::exception& e) {
+            zap::warn("failed to fetch ", url, ": ", e.what());
+            ++failed;
+        }
+    }
+
+    zap::die_if(
+        failed > 0,
+        failed, " ", zap::plural("archive", "s", failed), " not fetched"
+    );
+}
+
+}
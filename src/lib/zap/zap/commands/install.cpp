@@ -1,6 +1,12 @@
+#include <fstream>
+
 #include <zap/commands/install.hpp>
 #include <zap/builder.hpp>
+#include <zap/prefetcher.hpp>
+#include <zap/zapfile_lock.hpp>
+#include <zap/package/list.hpp>
 #include <zap/utils.hpp>
+#include <zap/log.hpp>
 
 namespace zap::commands {
 
@@ -19,6 +25,10 @@ install::operator()()
         install_url(opts_.url);
     } else if (!opts_.directory.empty()) {
         install_directory(opts_.directory);
+    } else if (!opts_.file.empty()) {
+        install_file(opts_.file);
+    } else if (!opts_.zapfile.empty()) {
+        install_zapfile(opts_.zapfile);
     }
 }
 
@@ -27,9 +37,121 @@ install::install_url(const std::string& url)
 {
     std::cout << "installing " << url << std::endl;
 
-    auto ai = env().download_archive(url);
+    auto ai = env().download_archive(url, opts_.digest);
+
+    install_work(ai, opts_.args);
+
+    env().prune_work(ai.dir);
+}
+
+void
+install::install_file(const std::string& file)
+{
+    auto pl = zap::package::load_list(file);
+
+    // Downloads run ahead while the first packages build
+    zap::prefetcher pf(
+        env(),
+        zap::package::list_urls(pl),
+        opts_.prefetch,
+        false,
+        zap::package::list_digests(pl)
+    );
+    std::string last_dir;
+
+    for (const auto& le : pl) {
+        std::cout << "installing " << le.url << std::endl;
+
+        auto ai = pf.get(le.url);
+
+        install_work(ai, le.args);
 
-    install_archive(ai);
+        last_dir = ai.dir;
+    }
+
+    // Not before the end, prefetched work directories aren't built yet
+    env().prune_work(last_dir);
+}
+
+void
+install::install_zapfile(const std::string& file)
+{
+    auto lock_file = zap::zapfile_lock::file_of(file);
+    zap::zapfile_lock zl;
+
+    if (!zl.load(lock_file, file)) {
+        zap::zapfile zf;
+
+        zf.load(file, env().sys_db().remotes());
+        zl.resolve(file, zf);
+    }
+
+    zap::strings urls;
+    zap::string_map digests;
+
+    for (const auto& d : zl.deps) {
+        urls.push_back(d.url);
+
+        if (!d.digest.empty()) {
+            digests.insert_or_assign(d.url, d.digest);
+        }
+    }
+
+    zap::prefetcher pf(env(), urls, opts_.prefetch, false, digests);
+    std::string last_dir;
+
+    for (auto& d : zl.deps) {
+        std::cout << "installing " << d.url << std::endl;
+
+        auto ai = pf.get(d.url);
+        auto it = d.opts.find("configure");
+
+        if (d.build.empty()) {
+            d.build = zap::builder::detect(ai.source_dir);
+        }
+
+        install_work(
+            ai,
+            it != d.opts.end() ? it->second : zap::strings{},
+            d.build
+        );
+
+        env_db_archive ar;
+
+        // Locked digests are never replaced, let alone cleared
+        if (d.digest.empty() && env().env_db().has_archive(d.url, ar)) {
+            d.digest = ar.digest;
+        }
+
+        last_dir = ai.dir;
+    }
+
+    zl.save(lock_file);
+
+    env().prune_work(last_dir);
+}
+
+void
+install::install_work(
+    const archive_info& ai,
+    const zap::strings& args,
+    const std::string& build
+)
+{
+    // Concurrent runs building the same sources wait for the first one
+    auto l = env().lock("build", ai.dir);
+
+    if (!opts_.fresh && up_to_date(ai, args)) {
+        zap::log(ai.name, " ", ai.version, " is up to date");
+        return;
+    }
+
+    env().prepare_work(ai, opts_.fresh);
+    install_archive(ai, args, build);
+
+    std::ofstream ofs(stamp_file(ai), std::ios::trunc);
+
+    ofs << zap::join(" ", args);
 }
 
 void
@@ -42,18 +164,60 @@ install::install_directory(const std::string& dir)
         .source_dir = dir
     };
 
-    install_archive(ai);
+    install_archive(ai, opts_.args);
 }
 
 void
-install::install_archive(const archive_info& ai)
+install::install_archive(
+    const archive_info& ai,
+    const zap::strings& args,
+    const std::string& build
+)
 {
-    zap::builder b(env(), ai, opts_.args);
-    zap::package::manifest pm;
+    zap::builder b(env(), ai, args, build);
+    zap::package::manifest pm(
+        ai.name.empty() ? zap::basename(ai.source_dir) : ai.name,
+        ai.version.empty() ? "local" : ai.version
+    );
+
+    env_db_build_time bt{ .pkg = pm.name() };
+
+    bt.configure_ms = zap::timed([&] { b.configure(); });
+    bt.build_ms = zap::timed([&] { b.build(); });
+
+    zap::log(
+        bt.pkg, ": configured in ",
+        zap::human_readable_duration(bt.configure_ms),
+        ", built in ",
+        zap::human_readable_duration(bt.build_ms)
+    );
+
+    env().env_db().set_build_time(bt);
 
-    b.configure();
-    b.build();
     b.install(pm);
 }
 
+bool
+install::up_to_date(
+    const archive_info& ai,
+    const zap::strings& args
+) const
+{
+    env_db_pkg pkg;
+
+    return
+        zap::file_exists(stamp_file(ai))
+        &&
+        zap::slurp(stamp_file(ai)) == zap::join(" ", args)
+        &&
+        env().env_db().has_package(ai.name, pkg)
+        &&
+        pkg.version == ai.version
+        ;
+}
+
+std::string
+install::stamp_file(const archive_info& ai)
+{ return zap::cat_file(ai.dir, ".zap-installed"); }
+
 }
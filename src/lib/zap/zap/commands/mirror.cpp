@@ -0,0 +1,104 @@
+#include <zap/commands/mirror.hpp>
+#include <zap/prefetcher.hpp>
+#include <zap/zapfile.hpp>
+#include <zap/package/list.hpp>
+#include <zap/utils.hpp>
+#include <zap/log.hpp>
+
+namespace zap::commands {
+
+mirror::mirror(const zap::env& e, const mirror_opts& opts)
+: zap::command(e),
+opts_(opts)
+{}
+
+mirror::~mirror()
+{}
+
+void
+mirror::operator()()
+{
+    switch (opts_.cmd) {
+        case mirror_cmd::sync:
+        sync();
+        break;
+    }
+}
+
+void
+mirror::sync()
+{
+    zap::strings urls;
+    zap::string_map digests;
+
+    load_urls(urls, digests);
+
+    zap::prefetcher pf(env(), urls, opts_.jobs, true, digests);
+    std::size_t added = 0;
+
+    for (const auto& url : urls) {
+        auto ai = pf.get(url);
+
+        // Repositories have their own shared git mirror
+        if (ai.file.empty()) {
+            continue;
+        }
+
+        auto to = zap::cat_file(
+            opts_.directory,
+            zap::fetcher::mirror_path(url)
+        );
+
+        if (zap::file_exists(to)) {
+            continue;
+        }
+
+        // Builds reading the mirror never see partial archives
+        auto tmp = zap::cat(to, ".zap-tmp");
+
+        zap::mkfilepath(to);
+        zap::die_unless(
+            zap::copy_file(ai.file, tmp),
+            "failed to copy ", ai.file, " to ", tmp
+        );
+        zap::rename(tmp, to);
+
+        zap::log("mirrored ", url);
+        ++added;
+    }
+
+    zap::log(
+        opts_.directory, ": ", added, " new ",
+        zap::plural("archive", "s", added), ", ",
+        urls.size() - added, " up to date"
+    );
+}
+
+void
+mirror::load_urls(zap::strings& urls, zap::string_map& digests) const
+{
+    if (!opts_.file.empty()) {
+        auto pl = zap::package::load_list(opts_.file);
+
+        urls = zap::package::list_urls(pl);
+        digests = zap::package::list_digests(pl);
+
+        return;
+    }
+
+    zap::zapfile zf;
+
+    zf.load("Zapfile", env().sys_db().remotes());
+
+    for (const auto& d : zf.deps) {
+        auto url = zap::remote_to_string(d.r);
+
+        if (!d.digest.empty()) {
+            digests.insert_or_assign(url, d.digest);
+        }
+
+        urls.push_back(std::move(url));
+    }
+}
+
+}
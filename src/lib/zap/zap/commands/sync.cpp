@@ -0,0 +1,555 @@
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <filesystem>
+#include <thread>
+
+#include <zap/commands/sync.hpp>
+#include <zap/builder.hpp>
+#include <zap/digest.hpp>
+#include <zap/zapfile.hpp>
+#include <zap/package/installer.hpp>
+#include <zap/utils.hpp>
+#include <zap/log.hpp>
+
+namespace zap::commands {
+
+static const char* action_names[] = {
+    "none",
+    "install",
+    "upgrade",
+    "rebuild"
+};
+
+sync::sync(const zap::env& e, const sync_opts& opts)
+: zap::command(e),
+opts_(opts)
+{}
+
+sync::~sync()
+{}
+
+void
+sync::operator()()
+{
+    auto lock_file = zap::zapfile_lock::file_of(opts_.zapfile);
+    bool changed = !lock_.load(lock_file, opts_.zapfile);
+
+    // An up to date lock is all there is to read
+    if (changed) {
+        zap::zapfile zf;
+
+        zf.load(opts_.zapfile, env().sys_db().remotes());
+        lock_.resolve(opts_.zapfile, zf);
+    }
+
+    for (auto& d : lock_.deps) {
+        steps_.emplace_back(step{ &d });
+    }
+
+    if (fetch_unlocked()) {
+        changed = true;
+    }
+
+    set_waves();
+    set_inputs();
+    plan();
+    print_plan();
+
+    if (opts_.dry_run) {
+        return;
+    }
+
+    remove();
+    run();
+
+    auto acted = std::any_of(
+        steps_.begin(), steps_.end(),
+        [](const auto& s) { return s.action != sync_action::none; }
+    );
+
+    if (changed || acted) {
+        lock_.save(lock_file);
+    }
+}
+
+bool
+sync::fetch_unlocked()
+{
+    zap::strings urls;
+
+    for (const auto& d : lock_.deps) {
+        if (d.digest.empty()) {
+            urls.push_back(d.url);
+        }
+    }
+
+    if (urls.empty()) {
+        return false;
+    }
+
+    zap::prefetcher pf(env(), urls, opts_.prefetch, true);
+
+    for (auto& d : lock_.deps) {
+        env_db_archive ar;
+
+        if (d.digest.empty()) {
+            pf.get(d.url);
+
+            if (env().env_db().has_archive(d.url, ar)) {
+                d.digest = ar.digest;
+            }
+        }
+    }
+
+    return true;
+}
+
+void
+sync::set_waves()
+{
+    auto& index = index_;
+
+    for (std::size_t i = 0; i < steps_.size(); ++i) {
+        die_unless(
+            index.try_emplace(steps_[i].d->name, i).second,
+            "duplicate dependency: ", steps_[i].d->name
+        );
+    }
+
+    // 0: not visited, 1: in progress, 2: done
+    std::vector<int> state(steps_.size(), 0);
+
+    std::function<void(std::size_t)> visit = [&](std::size_t i) {
+        auto& s = steps_[i];
+
+        die_if(state[i] == 1, "dependency cycle through ", s.d->name);
+
+        if (state[i] == 2) {
+            return;
+        }
+
+        state[i] = 1;
+
+        for (const auto& name : s.d->needs) {
+            auto it = index.find(name);
+
+            die_if(
+                it == index.end(),
+                s.d->name, " requires unknown dependency: ", name
+            );
+
+            visit(it->second);
+            s.wave = std::max(s.wave, steps_[it->second].wave + 1);
+        }
+
+        state[i] = 2;
+    };
+
+    for (std::size_t i = 0; i < steps_.size(); ++i) {
+        visit(i);
+    }
+}
+
+void
+sync::set_inputs()
+{
+    std::vector<step*> order;
+
+    for (auto& s : steps_) {
+        order.push_back(&s);
+    }
+
+    // Requirements first
+    std::stable_sort(
+        order.begin(), order.end(),
+        [](const auto* a, const auto* b) { return a->wave < b->wave; }
+    );
+
+    auto add = [](zap::hasher& h, const std::string& s) {
+        // Fields are NUL terminated so that they can't run into each other
+        h.update(s.c_str(), s.size() + 1);
+    };
+
+    for (auto* s : order) {
+        const auto& d = *s->d;
+        zap::hasher h;
+        zap::strings keys;
+
+        add(h, d.url);
+        add(h, d.digest);
+
+        for (const auto& p : d.opts) {
+            keys.push_back(p.first);
+        }
+
+        std::sort(keys.begin(), keys.end());
+
+        for (const auto& key : keys) {
+            add(h, key);
+
+            for (const auto& opt : d.opts.at(key)) {
+                add(h, opt);
+            }
+        }
+
+        s->own = h.final();
+
+        zap::hasher ih;
+        auto needs = d.needs;
+
+        std::sort(needs.begin(), needs.end());
+        add(ih, s->own);
+
+        for (const auto& name : needs) {
+            add(ih, name);
+            add(ih, steps_[index_.at(name)].inputs);
+        }
+
+        s->inputs = ih.final();
+    }
+}
+
+void
+sync::plan()
+{
+    auto& db = env().env_db();
+    std::unordered_map<std::string, env_db_synced> synced;
+
+    for (auto& s : db.synced()) {
+        auto name = s.name;
+
+        synced.try_emplace(std::move(name), std::move(s));
+    }
+
+    for (auto& s : steps_) {
+        auto it = synced.find(s.d->name);
+        env_db_pkg pkg;
+
+        if (it == synced.end()) {
+            s.action = sync_action::install;
+            continue;
+        }
+
+        const auto& prev = it->second;
+
+        s.pkg = prev.pkg;
+
+        if (!db.has_package(prev.pkg, pkg)) {
+            // Uninstalled behind our back
+            s.action = sync_action::install;
+        } else if (prev.url != s.d->url) {
+            s.action = sync_action::upgrade;
+        } else if (prev.inputs != s.inputs) {
+            // Options or requirements changed
+            s.action = sync_action::rebuild;
+            s.reqs_only = prev.own == s.own;
+        }
+
+        synced.erase(it);
+    }
+
+    for (auto& p : synced) {
+        removed_.emplace_back(std::move(p.second));
+    }
+}
+
+void
+sync::print_plan() const
+{
+    std::size_t count = removed_.size();
+
+    for (const auto& s : steps_) {
+        if (s.action != sync_action::none) {
+            zap::log(
+                action_names[static_cast<int>(s.action)], " ", s.d->name,
+                " (wave ", s.wave + 1, ")"
+            );
+            ++count;
+        }
+    }
+
+    for (const auto& s : removed_) {
+        zap::log("remove ", s.name, " (", s.pkg, ")");
+    }
+
+    if (count == 0) {
+        zap::log(opts_.zapfile, ": everything is up to date");
+    }
+}
+
+void
+sync::remove()
+{
+    zap::package::installer inst(env());
+    auto& db = env().env_db();
+
+    for (const auto& s : removed_) {
+        env_db_pkg pkg;
+
+        if (db.has_package(s.pkg, pkg)) {
+            inst.uninstall(s.pkg);
+        }
+
+        db.remove_synced(s.name);
+    }
+}
+
+void
+sync::run()
+{
+    std::size_t waves = 0;
+    zap::strings urls;
+    zap::string_map digests;
+
+    for (const auto& s : steps_) {
+        waves = std::max(waves, s.wave + 1);
+    }
+
+    // Archives of the first waves are downloaded first
+    for (std::size_t w = 0; w < waves; ++w) {
+        for (const auto& s : steps_) {
+            if (s.wave == w && s.action != sync_action::none) {
+                urls.push_back(s.d->url);
+                digests.insert_or_assign(s.d->url, s.d->digest);
+            }
+        }
+    }
+
+    if (urls.empty()) {
+        return;
+    }
+
+    pf_ = std::make_unique<zap::prefetcher>(
+        env(), urls, opts_.prefetch, false, digests
+    );
+
+    for (std::size_t w = 0; w < waves; ++w) {
+        std::vector<step*> ws;
+
+        for (auto& s : steps_) {
+            if (
+                s.wave == w
+                &&
+                s.action != sync_action::none
+                &&
+                !skip_step(s)
+            ) {
+                ws.push_back(&s);
+            }
+        }
+
+        std::vector<std::exception_ptr> errors(ws.size());
+        std::vector<std::thread> workers;
+        std::atomic<std::size_t> next = 0;
+        auto jobs = std::clamp<std::size_t>(opts_.jobs, 1, ws.size());
+
+        for (std::size_t i = 0; i < jobs && !ws.empty(); ++i) {
+            workers.emplace_back([&] {
+                for (auto j = next++; j < ws.size(); j = next++) {
+                    try {
+                        run_step(*ws[j]);
+                    } catch (...) {
+                        errors[j] = std::current_exception();
+                    }
+                }
+            });
+        }
+
+        for (auto& t : workers) {
+            t.join();
+        }
+
+        // Later waves build against this one
+        for (const auto& e : errors) {
+            if (e) {
+                std::rethrow_exception(e);
+            }
+        }
+    }
+
+    pf_.reset();
+
+    env().prune_work(last_dir_);
+}
+
+void
+sync::run_step(step& s)
+{
+    auto& d = *s.d;
+    auto ai = pf_->get(d.url);
+    auto it = d.opts.find("configure");
+
+    // Concurrent runs building the same sources wait for the first one
+    auto l = env().lock("build", ai.dir);
+
+    env().prepare_work(ai);
+
+    zap::builder b(
+        env(),
+        ai,
+        it != d.opts.end() ? it->second : zap::strings{},
+        d.build
+    );
+    zap::package::manifest pm(ai.name, ai.version);
+    env_db_build_time bt{ .pkg = pm.name() };
+
+    bt.configure_ms = zap::timed([&] { b.configure(); });
+    bt.build_ms = zap::timed([&] { b.build(); });
+
+    std::lock_guard<std::mutex> g(m_);
+    auto& db = env().env_db();
+    env_db_pkg pkg;
+    abi_map before;
+
+    if (!s.pkg.empty() && db.has_package(s.pkg, pkg)) {
+        before = shared_abis(s.pkg);
+
+        // Upstream renamed the package
+        if (s.pkg != pm.name()) {
+            zap::package::installer(env()).uninstall(s.pkg);
+        }
+    }
+
+    b.install(pm);
+
+    s.compatible = check_abi(s, before, shared_abis(pm.name()));
+
+    db.set_build_time(bt);
+    db.set_synced(
+        env_db_synced{ d.name, d.url, pm.name(), s.own, s.inputs }
+    );
+
+    d.build = b.type();
+    last_dir_ = ai.dir;
+
+    zap::log(
+        d.name, ": ", action_names[static_cast<int>(s.action)], " done in ",
+        zap::human_readable_duration(bt.configure_ms + bt.build_ms)
+    );
+}
+
+bool
+sync::skip_step(step& s)
+{
+    if (!s.reqs_only) {
+        return false;
+    }
+
+    bool changed = false;
+
+    for (const auto& name : s.d->needs) {
+        const auto& r = steps_[index_.at(name)];
+
+        if (r.action == sync_action::none) {
+            continue;
+        } else if (!r.compatible) {
+            return false;
+        }
+
+        changed = true;
+    }
+
+    // Requirements changed by an earlier, interrupted sync
+    if (!changed) {
+        return false;
+    }
+
+    env().env_db().set_synced(
+        env_db_synced{ s.d->name, s.d->url, s.pkg, s.own, s.inputs }
+    );
+
+    zap::log(s.d->name, " is up to date, requirements kept their ABI");
+
+    return true;
+}
+
+sync::abi_map
+sync::shared_abis(const std::string& pkg) const
+{
+    abi_map abis;
+
+    for (const auto& pf : env().env_db().package_files(pkg)) {
+        auto base = zap::basename(pf.file);
+        auto pos = base.find(".so");
+
+        // libz.so, libz.so.1 and libz.so.1.2.13 are links to one library
+        if (
+            pos == std::string::npos
+            ||
+            (pos + 3 != base.size() && base[pos + 3] != '.')
+        ) {
+            continue;
+        }
+
+        auto path = zap::cat_file(env()["root"], pf.file);
+        std::error_code ec;
+
+        if (std::filesystem::is_symlink(path, ec) || ec) {
+            continue;
+        }
+
+        zap::elf_abi abi;
+
+        if (zap::read_elf_abi(path, abi)) {
+            abis.insert_or_assign(base.substr(0, pos), std::move(abi));
+        }
+    }
+
+    return abis;
+}
+
+bool
+sync::check_abi(
+    const step& s,
+    const abi_map& before,
+    const abi_map& after
+) const
+{
+    const auto& name = s.d->name;
+
+    if (before.empty()) {
+        // Static libraries and headers are compiled into dependents
+        zap::log(name, ": no previous shared library, ABI changed");
+        return false;
+    }
+
+    bool compatible = true;
+
+    for (const auto& p : before) {
+        auto it = after.find(p.first);
+
+        if (it == after.end()) {
+            zap::log(name, ": ", p.first, " removed, ABI changed");
+            compatible = false;
+            continue;
+        }
+
+        auto d = zap::diff_abi(p.second, it->second);
+
+        zap::log(
+            name, ": ", p.first, " ",
+            d.compatible() ? "ABI compatible" : "ABI changed",
+            " (", d.added.size(), " added, ",
+            d.removed.size(), " removed)"
+        );
+
+        if (d.old_soname != d.new_soname) {
+            zap::log("  SONAME ", d.old_soname, " -> ", d.new_soname);
+        }
+
+        for (const auto& sym : d.added) {
+            zap::log("  + ", sym);
+        }
+
+        for (const auto& sym : d.removed) {
+            zap::log("  - ", sym);
+        }
+
+        compatible = compatible && d.compatible();
+    }
+
+    return compatible;
+}
+
+}
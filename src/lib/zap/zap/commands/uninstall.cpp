@@ -0,0 +1,24 @@
+#include <zap/commands/uninstall.hpp>
+#include <zap/package/installer.hpp>
+
+namespace zap::commands {
+
+uninstall::uninstall(const zap::env& e, const uninstall_opts& opts)
+: zap::command(e),
+opts_(opts)
+{}
+
+uninstall::~uninstall()
+{}
+
+void
+uninstall::operator()()
+{
+    zap::package::installer inst(env());
+
+    for (const auto& pkg : opts_.pkgs) {
+        inst.uninstall(pkg);
+    }
+}
+
+}
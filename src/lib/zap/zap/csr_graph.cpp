@@ -0,0 +1,464 @@
+#include <algorithm>
+#include <limits>
+#include <numeric>
+
+#include <zap/csr_graph.hpp>
+#include <zap/utils.hpp>
+
+namespace zap {
+
+static constexpr csr_graph::node_id no_node =
+    std::numeric_limits<csr_graph::node_id>::max();
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Node groups
+//
+///////////////////////////////////////////////////////////////////////////////
+std::size_t
+csr_graph::groups::size() const
+{ return offsets.size() - 1; }
+
+bool
+csr_graph::groups::empty() const
+{ return size() == 0; }
+
+csr_graph::node_span
+csr_graph::groups::operator[](std::size_t i) const
+{
+    return {
+        nodes.data() + offsets[i],
+        offsets[i + 1] - offsets[i]
+    };
+}
+
+void
+csr_graph::groups::add(node_span ns)
+{
+    nodes.insert(nodes.end(), ns.begin(), ns.end());
+    offsets.push_back(nodes.size());
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// CSR graph
+//
+///////////////////////////////////////////////////////////////////////////////
+csr_graph::csr_graph()
+{}
+
+csr_graph::~csr_graph()
+{}
+
+void
+csr_graph::clear()
+{
+    names_.clear();
+    ids_.clear();
+    pending_.clear();
+    offs_.clear();
+    adj_.clear();
+    rev_offs_.clear();
+    rev_adj_.clear();
+    built_ = false;
+}
+
+csr_graph::node_id
+csr_graph::add_node(const std::string& name)
+{
+    auto [ it, inserted ] = ids_.try_emplace(name, names_.size());
+
+    if (inserted) {
+        die_if(
+            names_.size() == no_node,
+            "too many graph nodes"
+        );
+
+        names_.push_back(name);
+        built_ = false;
+    }
+
+    return it->second;
+}
+
+void
+csr_graph::add_edge(node_id from, node_id to)
+{
+    pending_.emplace_back(from, to);
+    built_ = false;
+}
+
+void
+csr_graph::add_edge(const std::string& from, const std::string& to)
+{ add_edge(add_node(from), add_node(to)); }
+
+bool
+csr_graph::has_node(const std::string& name) const
+{ return ids_.contains(name); }
+
+csr_graph::node_id
+csr_graph::id(const std::string& name) const
+{
+    auto it = ids_.find(name);
+
+    die_if(it == ids_.end(), "unknown graph node: ", name);
+
+    return it->second;
+}
+
+const std::string&
+csr_graph::name(node_id v) const
+{ return names_[v]; }
+
+std::size_t
+csr_graph::size() const
+{ return names_.size(); }
+
+std::size_t
+csr_graph::edge_count() const
+{
+    check_built();
+
+    return adj_.size();
+}
+
+bool
+csr_graph::built() const
+{ return built_; }
+
+void
+csr_graph::build()
+{
+    auto n = names_.size();
+
+    // Counting sort of edges by source node, stable so insertion order is
+    // kept within each adjacency range
+    offs_.assign(n + 1, 0);
+
+    for (const auto& e : pending_) {
+        ++offs_[e.first + 1];
+    }
+
+    std::partial_sum(offs_.begin(), offs_.end(), offs_.begin());
+
+    adj_.resize(pending_.size());
+
+    positions pos(offs_.begin(), offs_.end() - 1);
+
+    for (const auto& e : pending_) {
+        adj_[pos[e.first]++] = e.second;
+    }
+
+    // Drop duplicate edges, keeping the first occurrence
+    node_ids stamp(n, no_node);
+    std::size_t out = 0;
+
+    for (node_id v = 0; v < n; ++v) {
+        auto begin = offs_[v];
+        auto end = offs_[v + 1];
+
+        offs_[v] = out;
+
+        for (auto i = begin; i < end; ++i) {
+            auto w = adj_[i];
+
+            if (stamp[w] != v) {
+                stamp[w] = v;
+                adj_[out++] = w;
+            }
+        }
+    }
+
+    offs_[n] = out;
+    adj_.resize(out);
+    adj_.shrink_to_fit();
+
+    // Reverse adjacency (dependents)
+    rev_offs_.assign(n + 1, 0);
+
+    for (auto w : adj_) {
+        ++rev_offs_[w + 1];
+    }
+
+    std::partial_sum(rev_offs_.begin(), rev_offs_.end(), rev_offs_.begin());
+
+    rev_adj_.resize(adj_.size());
+    pos.assign(rev_offs_.begin(), rev_offs_.end() - 1);
+
+    for (node_id v = 0; v < n; ++v) {
+        for (auto w : edges(v)) {
+            rev_adj_[pos[w]++] = v;
+        }
+    }
+
+    built_ = true;
+}
+
+csr_graph::node_span
+csr_graph::edges(node_id v) const
+{ return { adj_.data() + offs_[v], offs_[v + 1] - offs_[v] }; }
+
+csr_graph::node_span
+csr_graph::rev_edges(node_id v) const
+{
+    return {
+        rev_adj_.data() + rev_offs_[v],
+        rev_offs_[v + 1] - rev_offs_[v]
+    };
+}
+
+std::size_t
+csr_graph::out_degree(node_id v) const
+{ return offs_[v + 1] - offs_[v]; }
+
+std::size_t
+csr_graph::in_degree(node_id v) const
+{ return rev_offs_[v + 1] - rev_offs_[v]; }
+
+csr_graph::groups
+csr_graph::sccs() const
+{
+    // Please see:
+    //
+    // Tarjan's strongly connected components algorithm
+    //
+    // https://en.wikipedia.org/wiki/Tarjan%27s_strongly_connected_components_algorithm
+    //
+    // The recursion is replaced by an explicit stack of (node, next edge)
+    // frames so deep dependency chains can't overflow the call stack
+    check_built();
+
+    auto n = size();
+
+    groups comps;
+    node_ids index(n, no_node);
+    node_ids low(n);
+    std::vector<bool> on_stack(n, false);
+    node_ids st;
+    std::vector<std::pair<node_id, std::size_t>> frames;
+    node_id next = 0;
+
+    comps.nodes.reserve(n);
+
+    auto visit = [&](node_id v) {
+        index[v] = next;
+        low[v] = next;
+        ++next;
+
+        st.push_back(v);
+        on_stack[v] = true;
+
+        frames.emplace_back(v, offs_[v]);
+    };
+
+    for (node_id s = 0; s < n; ++s) {
+        if (index[s] != no_node) {
+            continue;
+        }
+
+        visit(s);
+
+        while (!frames.empty()) {
+            auto v = frames.back().first;
+            auto& pos = frames.back().second;
+
+            if (pos < offs_[v + 1]) {
+                auto w = adj_[pos++];
+
+                if (index[w] == no_node) {
+                    // Successor w has not yet been visited, descend
+                    visit(w);
+                } else if (on_stack[w]) {
+                    // Successor w is on the stack and hence in the current
+                    // SCC (index, not low link, as in the original paper)
+                    low[v] = std::min(low[v], index[w]);
+                }
+
+                continue;
+            }
+
+            // All successors done: if v is a root node, pop the SCC
+            if (low[v] == index[v]) {
+                auto it = std::find(st.rbegin(), st.rend(), v);
+                std::size_t first = (it.base() - st.begin()) - 1;
+
+                for (auto i = first; i < st.size(); ++i) {
+                    on_stack[st[i]] = false;
+                }
+
+                // Nodes come out in pop order, v last
+                std::reverse(st.begin() + first, st.end());
+
+                comps.add({ st.data() + first, st.size() - first });
+                st.resize(first);
+            }
+
+            frames.pop_back();
+
+            if (!frames.empty()) {
+                auto u = frames.back().first;
+
+                low[u] = std::min(low[u], low[v]);
+            }
+        }
+    }
+
+    return comps;
+}
+
+bool
+csr_graph::has_cycles() const
+{
+    auto comps = sccs();
+
+    if (comps.size() != size()) {
+        return true;
+    }
+
+    for (node_id v = 0; v < size(); ++v) {
+        const auto es = edges(v);
+
+        if (std::find(es.begin(), es.end(), v) != es.end()) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+csr_graph::node_ids
+csr_graph::toposort() const
+{
+    auto comps = sccs();
+
+    check_acyclic(comps);
+
+    return std::move(comps.nodes);
+}
+
+csr_graph::groups
+csr_graph::waves() const
+{
+    check_built();
+
+    auto n = size();
+
+    groups ws;
+    node_ids remaining(n);
+    node_ids current;
+    node_ids next;
+    std::size_t seen = 0;
+
+    ws.nodes.reserve(n);
+
+    for (node_id v = 0; v < n; ++v) {
+        remaining[v] = out_degree(v);
+
+        if (remaining[v] == 0) {
+            current.push_back(v);
+        }
+    }
+
+    while (!current.empty()) {
+        ws.add(current);
+        seen += current.size();
+        next.clear();
+
+        for (auto v : current) {
+            for (auto u : rev_edges(v)) {
+                if (--remaining[u] == 0) {
+                    next.push_back(u);
+                }
+            }
+        }
+
+        current.swap(next);
+    }
+
+    if (seen != n) {
+        check_acyclic(sccs());
+    }
+
+    return ws;
+}
+
+void
+csr_graph::check_built() const
+{ die_unless(built_, "graph is not built"); }
+
+void
+csr_graph::check_acyclic(const groups& comps) const
+{
+    for (std::size_t i = 0; i < comps.size(); ++i) {
+        auto comp = comps[i];
+        bool cyclic = comp.size() > 1;
+
+        if (!cyclic) {
+            auto es = edges(comp.front());
+
+            cyclic = std::find(es.begin(), es.end(), comp.front()) != es.end();
+        }
+
+        if (cyclic) {
+            strings names;
+
+            for (auto v : comp) {
+                names.push_back(name(v));
+            }
+
+            die("dependency cycle detected: ", join(" -> ", names));
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Ready queue
+//
+///////////////////////////////////////////////////////////////////////////////
+ready_queue::ready_queue(const csr_graph& g)
+: g_(g),
+remaining_(std::make_unique<std::atomic<std::uint32_t>[]>(g.size())),
+left_(g.size())
+{
+    die_unless(g_.built(), "graph is not built");
+
+    for (node_id v = 0; v < g_.size(); ++v) {
+        auto count = g_.out_degree(v);
+
+        remaining_[v].store(count, std::memory_order_relaxed);
+
+        if (count == 0) {
+            initial_.push_back(v);
+        }
+    }
+}
+
+ready_queue::~ready_queue()
+{}
+
+const ready_queue::node_ids&
+ready_queue::initial() const
+{ return initial_; }
+
+ready_queue::node_ids
+ready_queue::done(node_id v)
+{
+    node_ids ready;
+
+    for (auto u : g_.rev_edges(v)) {
+        if (remaining_[u].fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            ready.push_back(u);
+        }
+    }
+
+    left_.fetch_sub(1, std::memory_order_acq_rel);
+
+    return ready;
+}
+
+bool
+ready_queue::finished() const
+{ return left_.load(std::memory_order_acquire) == 0; }
+
+}
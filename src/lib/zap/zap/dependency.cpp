@@ -23,20 +23,24 @@ remote_to_string(const remote& r)
             [&oss](const remotes::github& r) {
                 oss
                     << remote_host_or(r, "https://github.com")
+                    << "/"
                     << join(
                         "/",
                         r.author,
+                        r.name,
                         "archive/refs/tags",
-                        join("-", r.name, r.ref) + ".zip"
+                        r.ref + ".zip"
                     )
                     ;
             },
             [&oss](const remotes::gitlab& r) {
                 oss
                     << remote_host_or(r, "https://gitlab.com")
+                    << "/"
                     << join(
                         "/",
                         r.author,
+                        r.name,
                         "-/archive",
                         r.ref,
                         join("-", r.name, r.ref) + ".zip"
@@ -53,6 +57,10 @@ remote_to_string(const remote& r)
     return oss.str();
 }
 
+const std::string&
+remote_name(const remote& r)
+{ return std::visit([](const auto& r) -> const auto& { return r.name; }, r); }
+
 remote
 to_remote(
     repository_type type,
@@ -61,29 +69,38 @@ to_remote(
     const std::string& ref
 )
 {
-    remote r;
-    url u(base);
+    auto pos = base.find("://");
     auto parts = split("/", spec);
 
-    die_unless(u.parsed, "invalid remote base: ", base);
+    die_if(pos == std::string::npos, "invalid remote base: ", base);
     die_unless(parts.size() == 2, "unknown remote spec: ", spec);
 
+    // Local roots (file:///srv/git) have no host, keep the whole path
+    remotes::git g{
+        .scheme = base.substr(0, pos),
+        .netloc = base.substr(pos + 3),
+        .author = std::string{ parts[0] },
+        .name = std::string{ parts[1] },
+        .ref = ref
+    };
+
+    while (g.netloc.ends_with('/')) {
+        g.netloc.pop_back();
+    }
+
     switch (type) {
         case repository_type::github:
-        r = remotes::github{{
-            .scheme = u.scheme,
-            .netloc = u.scheme
-        }};
-        break;
+        return remotes::github{ g };
         case repository_type::gitlab:
-        break;
+        return remotes::gitlab{ g };
         case repository_type::bitbucket:
-        break;
         case repository_type::none:
         break;
     }
 
-    return r;
+    die("unsupported remote type: ", to_string(type));
+
+    return {};
 }
 
 std::string
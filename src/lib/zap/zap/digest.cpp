@@ -0,0 +1,547 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <openssl/evp.h>
+
+#include <zap/digest.hpp>
+#include <zap/mapped_file.hpp>
+#include <zap/utils.hpp>
+#include <zap/log.hpp>
+
+namespace zap {
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// BLAKE3 (portable implementation of the reference hasher, unkeyed and 32
+// bytes output only)
+//
+///////////////////////////////////////////////////////////////////////////////
+namespace blake3 {
+
+static const std::size_t block_len = 64;
+static const std::size_t chunk_len = 1024;
+static const std::size_t out_len = 32;
+
+// Chunks per subtree hashed by a thread, a power of 2
+static const std::size_t subtree_chunks = 1024;
+
+// Domain flags
+static constexpr std::uint32_t chunk_start = 1 << 0;
+static constexpr std::uint32_t chunk_end = 1 << 1;
+static constexpr std::uint32_t parent = 1 << 2;
+static constexpr std::uint32_t root = 1 << 3;
+
+static const std::uint32_t iv[8] = {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+    0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+};
+
+static const std::size_t msg_permutation[16] = {
+    2, 6, 3, 10, 7, 0, 4, 13, 1, 11, 12, 5, 9, 14, 15, 8
+};
+
+using words = std::array<std::uint32_t, 16>;
+using cv_type = std::array<std::uint32_t, 8>;
+
+inline std::uint32_t
+rotr(std::uint32_t w, int c)
+{ return (w >> c) | (w << (32 - c)); }
+
+inline void
+g(words& s, int a, int b, int c, int d, std::uint32_t x, std::uint32_t y)
+{
+    s[a] = s[a] + s[b] + x;
+    s[d] = rotr(s[d] ^ s[a], 16);
+    s[c] = s[c] + s[d];
+    s[b] = rotr(s[b] ^ s[c], 12);
+    s[a] = s[a] + s[b] + y;
+    s[d] = rotr(s[d] ^ s[a], 8);
+    s[c] = s[c] + s[d];
+    s[b] = rotr(s[b] ^ s[c], 7);
+}
+
+inline void
+mix(words& s, const words& m)
+{
+    // Columns, then diagonals
+    g(s, 0, 4, 8, 12, m[0], m[1]);
+    g(s, 1, 5, 9, 13, m[2], m[3]);
+    g(s, 2, 6, 10, 14, m[4], m[5]);
+    g(s, 3, 7, 11, 15, m[6], m[7]);
+    g(s, 0, 5, 10, 15, m[8], m[9]);
+    g(s, 1, 6, 11, 12, m[10], m[11]);
+    g(s, 2, 7, 8, 13, m[12], m[13]);
+    g(s, 3, 4, 9, 14, m[14], m[15]);
+}
+
+words
+compress(
+    const cv_type& cv,
+    const words& block,
+    std::uint64_t counter,
+    std::uint32_t len,
+    std::uint32_t flags
+)
+{
+    words s = {
+        cv[0], cv[1], cv[2], cv[3], cv[4], cv[5], cv[6], cv[7],
+        iv[0], iv[1], iv[2], iv[3],
+        static_cast<std::uint32_t>(counter),
+        static_cast<std::uint32_t>(counter >> 32),
+        len,
+        flags
+    };
+    words m = block;
+
+    for (int r = 0; r < 7; ++r) {
+        mix(s, m);
+
+        if (r < 6) {
+            words p;
+
+            for (std::size_t i = 0; i < 16; ++i) {
+                p[i] = m[msg_permutation[i]];
+            }
+
+            m = p;
+        }
+    }
+
+    for (std::size_t i = 0; i < 8; ++i) {
+        s[i] ^= s[i + 8];
+        s[i + 8] ^= cv[i];
+    }
+
+    return s;
+}
+
+words
+load_block(const std::uint8_t* data, std::size_t size)
+{
+    std::uint8_t buf[block_len] = {};
+    words w;
+
+    std::memcpy(buf, data, size);
+
+    for (std::size_t i = 0; i < 16; ++i) {
+        w[i] =
+            std::uint32_t(buf[i * 4])
+            | std::uint32_t(buf[i * 4 + 1]) << 8
+            | std::uint32_t(buf[i * 4 + 2]) << 16
+            | std::uint32_t(buf[i * 4 + 3]) << 24
+            ;
+    }
+
+    return w;
+}
+
+cv_type
+first_8(const words& w)
+{ return { w[0], w[1], w[2], w[3], w[4], w[5], w[6], w[7] }; }
+
+// Inputs of a compression, the root one being compressed last
+struct output
+{
+    cv_type cv;
+    words block;
+    std::uint64_t counter;
+    std::uint32_t len;
+    std::uint32_t flags;
+
+    cv_type chaining_value() const
+    { return first_8(compress(cv, block, counter, len, flags)); }
+
+    cv_type root_value() const
+    { return first_8(compress(cv, block, 0, len, flags | root)); }
+};
+
+output
+parent_output(const cv_type& left, const cv_type& right)
+{
+    words block;
+
+    std::copy(left.begin(), left.end(), block.begin());
+    std::copy(right.begin(), right.end(), block.begin() + 8);
+
+    return output{ { iv[0], iv[1], iv[2], iv[3], iv[4], iv[5], iv[6], iv[7] },
+        block, 0, block_len, parent };
+}
+
+cv_type
+parent_cv(const cv_type& left, const cv_type& right)
+{ return parent_output(left, right).chaining_value(); }
+
+struct chunk_state
+{
+    chunk_state(std::uint64_t counter = 0)
+    : counter(counter)
+    {}
+
+    std::size_t len() const
+    { return blocks * block_len + buf_len; }
+
+    std::uint32_t start_flag() const
+    { return blocks == 0 ? chunk_start : 0; }
+
+    void update(const std::uint8_t* data, std::size_t size)
+    {
+        while (size > 0) {
+            if (buf_len == block_len) {
+                cv = first_8(compress(
+                    cv,
+                    load_block(buf, block_len),
+                    counter,
+                    block_len,
+                    start_flag()
+                ));
+                ++blocks;
+                buf_len = 0;
+            }
+
+            auto n = std::min(block_len - buf_len, size);
+
+            std::memcpy(buf + buf_len, data, n);
+            buf_len += n;
+            data += n;
+            size -= n;
+        }
+    }
+
+    output out() const
+    {
+        return output{
+            cv,
+            load_block(buf, buf_len),
+            counter,
+            static_cast<std::uint32_t>(buf_len),
+            start_flag() | chunk_end
+        };
+    }
+
+    cv_type cv{ iv[0], iv[1], iv[2], iv[3], iv[4], iv[5], iv[6], iv[7] };
+    std::uint64_t counter;
+    std::uint8_t buf[block_len] = {};
+    std::size_t buf_len = 0;
+    std::size_t blocks = 0;
+};
+
+class hasher
+{
+public:
+    void update(const std::uint8_t* data, std::size_t size)
+    {
+        while (size > 0) {
+            if (cs_.len() == chunk_len) {
+                // More input follows, the chunk can't be the root
+                auto total = cs_.counter + 1;
+
+                push_cv(cs_.out().chaining_value(), total);
+                cs_ = chunk_state(total);
+            }
+
+            auto n = std::min(chunk_len - cs_.len(), size);
+
+            cs_.update(data, n);
+            data += n;
+            size -= n;
+        }
+    }
+
+    // Subtree of `chunks` chunks starting at the current chunk, which must
+    // be empty and aligned on `chunks`, and followed by more input
+    void push_subtree(const cv_type& cv, std::uint64_t chunks)
+    {
+        auto total = cs_.counter + chunks;
+
+        push_cv(cv, total / chunks);
+        cs_ = chunk_state(total);
+    }
+
+    cv_type final() const
+    {
+        auto out = cs_.out();
+
+        for (auto it = stack_.rbegin(); it != stack_.rend(); ++it) {
+            out = parent_output(*it, out.chaining_value());
+        }
+
+        return out.root_value();
+    }
+
+private:
+    // Merges completed subtrees, as many as trailing zeros of total
+    void push_cv(cv_type cv, std::uint64_t total)
+    {
+        while ((total & 1) == 0) {
+            cv = parent_cv(stack_.back(), cv);
+            stack_.pop_back();
+            total >>= 1;
+        }
+
+        stack_.push_back(cv);
+    }
+
+    chunk_state cs_;
+    std::vector<cv_type> stack_;
+};
+
+// Chaining value of a full subtree of chunks, never the root
+cv_type
+subtree_cv(const std::uint8_t* data, std::size_t chunks, std::uint64_t first)
+{
+    std::vector<cv_type> cvs(chunks);
+
+    for (std::size_t i = 0; i < chunks; ++i) {
+        chunk_state cs(first + i);
+
+        cs.update(data + i * chunk_len, chunk_len);
+        cvs[i] = cs.out().chaining_value();
+    }
+
+    for (; chunks > 1; chunks /= 2) {
+        for (std::size_t i = 0; i < chunks / 2; ++i) {
+            cvs[i] = parent_cv(cvs[2 * i], cvs[2 * i + 1]);
+        }
+    }
+
+    return cvs.front();
+}
+
+std::string
+to_hex(const cv_type& cv)
+{
+    static const char hex[] = "0123456789abcdef";
+
+    std::string s;
+
+    s.reserve(out_len * 2);
+
+    for (auto w : cv) {
+        for (int i = 0; i < 4; ++i) {
+            std::uint8_t b = w >> (8 * i);
+
+            s += hex[b >> 4];
+            s += hex[b & 0xf];
+        }
+    }
+
+    return s;
+}
+
+std::string
+hash(const std::uint8_t* data, std::size_t size)
+{
+    static const std::size_t subtree_len = subtree_chunks * chunk_len;
+
+    // Full subtrees, the last one excluded: it may be the root
+    auto subtrees = size > 0 ? (size - 1) / subtree_len : 0;
+    std::vector<cv_type> cvs(subtrees);
+    std::atomic<std::size_t> next = 0;
+
+    auto worker = [&] {
+        for (auto i = next++; i < subtrees; i = next++) {
+            cvs[i] = subtree_cv(
+                data + i * subtree_len,
+                subtree_chunks,
+                i * subtree_chunks
+            );
+        }
+    };
+
+    std::vector<std::thread> workers;
+    auto threads = std::min<std::size_t>(
+        std::max(1u, std::thread::hardware_concurrency()),
+        subtrees
+    );
+
+    for (std::size_t i = 1; i < threads; ++i) {
+        workers.emplace_back(worker);
+    }
+
+    worker();
+
+    for (auto& w : workers) {
+        w.join();
+    }
+
+    hasher h;
+
+    for (const auto& cv : cvs) {
+        h.push_subtree(cv, subtree_chunks);
+    }
+
+    h.update(data + subtrees * subtree_len, size - subtrees * subtree_len);
+
+    return to_hex(h.final());
+}
+
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Hasher
+//
+///////////////////////////////////////////////////////////////////////////////
+struct hasher::state
+{
+    using evp_ptr = std::unique_ptr<EVP_MD_CTX, decltype(&EVP_MD_CTX_free)>;
+
+    evp_ptr evp{ nullptr, &EVP_MD_CTX_free };
+    blake3::hasher b3;
+};
+
+hasher::hasher(const std::string& algo)
+: algo_(algo),
+state_(std::make_unique<state>())
+{
+    die_unless(
+        algo_ == "sha256" || algo_ == "blake3",
+        "unsupported digest algorithm: ", algo_
+    );
+
+    if (algo_ == "sha256") {
+        state_->evp.reset(EVP_MD_CTX_new());
+
+        die_unless(
+            state_->evp
+            &&
+            EVP_DigestInit_ex(state_->evp.get(), EVP_sha256(), nullptr) == 1,
+            "failed to initialize SHA-256 digest"
+        );
+    }
+}
+
+hasher::~hasher()
+{}
+
+void
+hasher::update(const void* data, std::size_t size)
+{
+    if (state_->evp) {
+        EVP_DigestUpdate(state_->evp.get(), data, size);
+    } else {
+        state_->b3.update(static_cast<const std::uint8_t*>(data), size);
+    }
+}
+
+std::string
+hasher::final()
+{
+    static const char hex[] = "0123456789abcdef";
+
+    if (!state_->evp) {
+        return zap::cat(algo_, ':', blake3::to_hex(state_->b3.final()));
+    }
+
+    unsigned char md[EVP_MAX_MD_SIZE];
+    unsigned int size = 0;
+
+    EVP_DigestFinal_ex(state_->evp.get(), md, &size);
+
+    std::string digest = zap::cat(algo_, ':');
+
+    for (unsigned int i = 0; i < size; ++i) {
+        digest += hex[md[i] >> 4];
+        digest += hex[md[i] & 0xf];
+    }
+
+    return digest;
+}
+
+const std::string&
+hasher::algo() const
+{ return algo_; }
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Digests
+//
+///////////////////////////////////////////////////////////////////////////////
+bool
+valid_digest(const std::string& digest)
+{
+    auto algo = digest_algo(digest);
+    auto hex = digest_hex(digest);
+
+    return
+        (algo == "sha256" || algo == "blake3")
+        &&
+        hex.size() == 64
+        &&
+        hex.find_first_not_of("0123456789abcdef") == std::string::npos
+        ;
+}
+
+std::string
+digest_algo(const std::string& digest)
+{ return digest.substr(0, digest.find(':')); }
+
+std::string
+digest_hex(const std::string& digest)
+{
+    auto pos = digest.find(':');
+
+    return pos != std::string::npos ? digest.substr(pos + 1) : std::string{};
+}
+
+std::string
+digest_file(const std::string& algo, const std::string& path)
+{
+    if (algo == "sha256") {
+        return zap::cat(algo, ':', sha256_file(path));
+    }
+
+    die_unless(algo == "blake3", "unsupported digest algorithm: ", algo);
+
+    mapped_file mf(path);
+
+    return zap::cat(
+        algo, ':',
+        blake3::hash(
+            reinterpret_cast<const std::uint8_t*>(mf.data()),
+            mf.size()
+        )
+    );
+}
+
+std::string
+sha256_file(const std::string& path)
+{
+    std::ifstream ifs(path, std::ios::binary);
+
+    die_unless(ifs.good(), "failed to open ", path);
+
+    hasher h("sha256");
+    std::vector<char> buf(1 << 20);
+
+    while (ifs) {
+        ifs.read(buf.data(), buf.size());
+
+        if (ifs.gcount() > 0) {
+            h.update(buf.data(), ifs.gcount());
+        }
+    }
+
+    die_if(ifs.bad(), "failed to read ", path);
+
+    return digest_hex(h.final());
+}
+
+std::string
+digest_key(const std::string& s)
+{
+    hasher h("sha256");
+
+    h.update(s.data(), s.size());
+
+    return digest_hex(h.final()).substr(0, 16);
+}
+
+}
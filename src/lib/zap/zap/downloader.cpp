@@ -0,0 +1,576 @@
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <fstream>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#define CPPHTTPLIB_OPENSSL_SUPPORT
+#include <httplib.h>
+
+#include <zap/downloader.hpp>
+#include <zap/digest.hpp>
+#include <zap/utils.hpp>
+#include <zap/log.hpp>
+#include <zap/scope.hpp>
+#include <zap/url.hpp>
+
+namespace zap {
+
+static const std::size_t max_redirects = 10;
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Connection pool
+//
+///////////////////////////////////////////////////////////////////////////////
+namespace detail {
+
+using client_ptr = std::unique_ptr<httplib::Client>;
+
+class client_pool
+{
+public:
+    client_ptr acquire(const std::string& host)
+    {
+        {
+            std::lock_guard<std::mutex> l(m_);
+
+            auto& free = clients_[host];
+
+            if (!free.empty()) {
+                auto c = std::move(free.back());
+
+                free.pop_back();
+
+                return c;
+            }
+        }
+
+        auto c = std::make_unique<httplib::Client>(host);
+
+        c->set_keep_alive(true);
+        c->set_connection_timeout(30);
+        c->set_read_timeout(60);
+
+        // TOFIX: need to find a better way to fix this
+        c->enable_server_certificate_verification(false);
+
+        return c;
+    }
+
+    void release(const std::string& host, client_ptr c)
+    {
+        std::lock_guard<std::mutex> l(m_);
+
+        clients_[host].emplace_back(std::move(c));
+    }
+
+private:
+    std::mutex m_;
+    std::unordered_map<std::string, std::vector<client_ptr>> clients_;
+};
+
+client_pool&
+pool()
+{
+    static client_pool p;
+
+    return p;
+}
+
+// Client borrowed from the pool for the lifetime of the object
+struct pooled_client
+{
+    pooled_client(const zap::url& u)
+    : host(u.host()),
+    c(pool().acquire(host))
+    {}
+
+    ~pooled_client()
+    { pool().release(host, std::move(c)); }
+
+    httplib::Client* operator->()
+    { return c.get(); }
+
+    std::string host;
+    client_ptr c;
+};
+
+zap::url
+parse_url(const std::string& s)
+{
+    zap::url u(s);
+
+    die_unless(u.parsed, "invalid url: ", s);
+
+    if (u.uri.empty()) {
+        u.uri = "/";
+    }
+
+    return u;
+}
+
+void
+read_at(int fd, char* data, std::size_t size, std::size_t offset)
+{
+    while (size > 0) {
+        auto n = ::pread(fd, data, size, offset);
+
+        if (n == -1 && errno == EINTR) {
+            continue;
+        }
+
+        sysdie_if(n <= 0, "failed to read downloaded data");
+
+        data += n;
+        size -= n;
+        offset += n;
+    }
+}
+
+void
+write_at(int fd, const char* data, std::size_t size, std::size_t offset)
+{
+    while (size > 0) {
+        auto n = ::pwrite(fd, data, size, offset);
+
+        if (n == -1 && errno == EINTR) {
+            continue;
+        }
+
+        sysdie_if(n == -1, "failed to write downloaded data");
+
+        data += n;
+        size -= n;
+        offset += n;
+    }
+}
+
+std::string
+error_string(const httplib::Result& res)
+{
+    return
+        res
+        ? cat("HTTP status ", res->status)
+        : httplib::to_string(res.error())
+        ;
+}
+
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Downloader
+//
+///////////////////////////////////////////////////////////////////////////////
+downloader::downloader(
+    const std::string& url,
+    const std::string& file,
+    const download_opts& opts,
+    const download_info& known
+)
+: url_(url),
+file_(file),
+opts_(opts),
+known_(known)
+{
+    opts_.connections = std::max<std::size_t>(opts_.connections, 1);
+    opts_.part_size = std::max<std::size_t>(opts_.part_size, 64 * 1024);
+}
+
+downloader::~downloader()
+{}
+
+download_info
+downloader::run()
+{
+    mkfilepath(file_);
+
+    head();
+
+    if (!info_.modified) {
+        return info_;
+    }
+
+    if (ranges_) {
+        fetch_parts();
+    } else {
+        fetch_stream();
+    }
+
+    rmfile(state_file());
+
+    if (!opts_.digest.empty() && info_.digest != opts_.digest) {
+        rmfile(file_);
+
+        die(
+            "digest mismatch for ", url_, ": expected ", opts_.digest,
+            ", got ", info_.digest
+        );
+    }
+
+    return info_;
+}
+
+void
+downloader::head()
+{
+    location_ = url_;
+
+    for (std::size_t i = 0; i < max_redirects; ++i) {
+        auto u = detail::parse_url(location_);
+        detail::pooled_client c(u);
+
+        httplib::Headers headers;
+
+        if (!known_.etag.empty()) {
+            headers.emplace("If-None-Match", known_.etag);
+        }
+
+        if (!known_.last_modified.empty()) {
+            headers.emplace("If-Modified-Since", known_.last_modified);
+        }
+
+        c->set_follow_location(false);
+
+        auto res = c->Head(u.uri, headers);
+
+        die_if(
+            !res,
+            "HTTP error while downloading ", url_, ": ",
+            detail::error_string(res)
+        );
+
+        if (
+            res->status >= 300 && res->status < 400
+            &&
+            res->has_header("Location")
+        ) {
+            auto location = res->get_header_value("Location");
+
+            location_ =
+                location.starts_with('/')
+                ? cat(u.host(), location)
+                : location
+                ;
+
+            continue;
+        }
+
+        if (res->status == 304) {
+            info_ = known_;
+            info_.modified = false;
+
+            return;
+        }
+
+        if (res->status != 200) {
+            // Some servers don't do HEAD, a plain GET will tell
+            return;
+        }
+
+        set_info(*res);
+
+        if (!info_.modified) {
+            info_.digest = known_.digest;
+            return;
+        }
+
+        ranges_ =
+            info_.size > 0
+            &&
+            res->get_header_value("Accept-Ranges") == "bytes"
+            ;
+
+        validator_ =
+            !info_.etag.empty()
+            ? info_.etag
+            : info_.last_modified
+            ;
+
+        return;
+    }
+
+    die("too many redirections while downloading ", url_);
+}
+
+void
+downloader::fetch_parts()
+{
+    auto parts = (info_.size + opts_.part_size - 1) / opts_.part_size;
+    std::vector<char> done(parts, false);
+    std::size_t remaining = parts;
+
+    // <url>\n<size>\n<validator>\n then one completed part index per line
+    {
+        std::ifstream ifs(state_file());
+        std::string url;
+        std::string size;
+        std::string validator;
+
+        if (
+            std::getline(ifs, url) && url == location_
+            &&
+            std::getline(ifs, size) && to_num<std::size_t>(size) == info_.size
+            &&
+            std::getline(ifs, validator) && validator == validator_
+            &&
+            file_exists(file_)
+        ) {
+            for (std::string line; std::getline(ifs, line); ) {
+                auto i = to_num<std::size_t>(line);
+
+                if (i < parts && !done[i]) {
+                    done[i] = true;
+                    --remaining;
+                }
+            }
+        } else {
+            rmfile(file_);
+        }
+    }
+
+    if (remaining < parts) {
+        log("resuming download of ", url_, ", ", remaining, " of ", parts,
+            " parts left");
+    }
+
+    int fd = ::open(file_.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+
+    sysdie_if(fd == -1, "failed to open file: ", file_);
+
+    scope s;
+
+    s.push([fd] { ::close(fd); });
+
+    if (::posix_fallocate(fd, 0, info_.size) != 0) {
+        sysdie_if(::ftruncate(fd, info_.size) == -1, "failed to size ", file_);
+    }
+
+    if (remaining == parts) {
+        std::ofstream ofs(state_file(), std::ios::trunc);
+
+        ofs << location_ << '\n' << info_.size << '\n' << validator_ << '\n';
+    }
+
+    std::ofstream state(state_file(), std::ios::app);
+    std::atomic<std::size_t> next = 0;
+    std::mutex m;
+    std::string error;
+    hasher h(digest_algo());
+    std::vector<char> buf(opts_.part_size);
+    std::size_t hashed = 0;
+
+    // Parts are hashed in order as soon as they are all there, while the
+    // next ones download
+    auto hash_parts = [&] {
+        for (; hashed < parts && done[hashed]; ++hashed) {
+            auto offset = hashed * opts_.part_size;
+            auto size = std::min(opts_.part_size, info_.size - offset);
+
+            detail::read_at(fd, buf.data(), size, offset);
+            h.update(buf.data(), size);
+        }
+    };
+
+    hash_parts();
+
+    auto worker = [&] {
+        for (auto i = next++; i < parts; i = next++) {
+            if (done[i]) {
+                continue;
+            }
+
+            try {
+                fetch_part(fd, i);
+            } catch (const std::exception& e) {
+                std::lock_guard<std::mutex> l(m);
+
+                if (error.empty()) {
+                    error = e.what();
+                }
+
+                // Other workers stop after their current part
+                next = parts;
+
+                return;
+            }
+
+            std::lock_guard<std::mutex> l(m);
+
+            state << i << std::endl;
+            done[i] = true;
+
+            hash_parts();
+        }
+    };
+
+    std::vector<std::thread> workers;
+
+    for (std::size_t i = 1; i < std::min(opts_.connections, remaining); ++i) {
+        workers.emplace_back(worker);
+    }
+
+    worker();
+
+    for (auto& w : workers) {
+        w.join();
+    }
+
+    die_unless(error.empty(), error);
+
+    info_.digest = h.final();
+}
+
+void
+downloader::fetch_part(int fd, std::size_t index) const
+{
+    auto u = detail::parse_url(location_);
+    auto offset = index * opts_.part_size;
+    auto end = std::min(offset + opts_.part_size, info_.size);
+
+    for (std::size_t attempt = 1; ; ++attempt) {
+        detail::pooled_client c(u);
+        bool partial = false;
+
+        c->set_follow_location(false);
+
+        // Byte ranges are inclusive
+        httplib::Headers headers{
+            httplib::make_range_header({ { offset, end - 1 } })
+        };
+
+        auto res = c->Get(
+            u.uri,
+            headers,
+            [&](const httplib::Response& r) {
+                partial = r.status == 206;
+
+                return partial;
+            },
+            [&](const char* data, std::size_t size) {
+                if (offset + size > end) {
+                    return false;
+                }
+
+                detail::write_at(fd, data, size, offset);
+                offset += size;
+
+                return true;
+            }
+        );
+
+        if (res && offset == end) {
+            return;
+        }
+
+        die_if(
+            res && !partial,
+            "server ignored range request for ", location_
+        );
+
+        die_if(
+            attempt >= opts_.retries,
+            "HTTP error while downloading ", url_, ": ",
+            detail::error_string(res)
+        );
+
+        warn(
+            "retrying download of ", url_, " from byte ", offset,
+            " (", detail::error_string(res), ")"
+        );
+    }
+}
+
+void
+downloader::fetch_stream()
+{
+    auto u = detail::parse_url(location_);
+
+    for (std::size_t attempt = 1; ; ++attempt) {
+        detail::pooled_client c(u);
+        std::size_t offset = 0;
+        hasher h(digest_algo());
+
+        int fd = ::open(
+            file_.c_str(),
+            O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+            0644
+        );
+
+        sysdie_if(fd == -1, "failed to open file: ", file_);
+
+        c->set_follow_location(true);
+
+        auto res = c->Get(
+            u.uri,
+            [&](const char* data, std::size_t size) {
+                detail::write_at(fd, data, size, offset);
+                h.update(data, size);
+                offset += size;
+
+                return true;
+            }
+        );
+
+        ::close(fd);
+
+        if (res && res->status == 200) {
+            set_info(*res);
+            info_.modified = true;
+            info_.digest = h.final();
+
+            return;
+        }
+
+        die_if(
+            attempt >= opts_.retries || (res && res->status < 500),
+            "HTTP error while downloading ", url_, ": ",
+            detail::error_string(res)
+        );
+
+        warn(
+            "retrying download of ", url_,
+            " (", detail::error_string(res), ")"
+        );
+    }
+}
+
+void
+downloader::set_info(const httplib::Response& res)
+{
+    info_.etag = res.get_header_value("ETag");
+    info_.last_modified = res.get_header_value("Last-Modified");
+    info_.size = to_num<std::size_t>(
+        res.get_header_value("Content-Length")
+    );
+
+    // Servers ignoring conditional requests still send the same validators
+    info_.modified =
+        !known_.etag.empty()
+        ? info_.etag != known_.etag
+        : (
+            known_.last_modified.empty()
+            ||
+            info_.last_modified != known_.last_modified
+            ||
+            info_.size != known_.size
+        )
+        ;
+}
+
+std::string
+downloader::digest_algo() const
+{ return opts_.digest.empty() ? "sha256" : zap::digest_algo(opts_.digest); }
+
+std::string
+downloader::state_file() const
+{ return cat(file_, ".state"); }
+
+}
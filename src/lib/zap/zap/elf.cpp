@@ -0,0 +1,240 @@
+#include <elf.h>
+
+#include <cstring>
+
+#include <zap/elf.hpp>
+#include <zap/mapped_file.hpp>
+#include <zap/utils.hpp>
+
+namespace zap {
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// ELF reader
+//
+///////////////////////////////////////////////////////////////////////////////
+namespace detail {
+
+struct elf32
+{
+    using ehdr = Elf32_Ehdr;
+    using shdr = Elf32_Shdr;
+    using sym = Elf32_Sym;
+    using dyn = Elf32_Dyn;
+
+    static unsigned char bind(unsigned char info)
+    { return ELF32_ST_BIND(info); }
+
+    static unsigned char visibility(unsigned char other)
+    { return ELF32_ST_VISIBILITY(other); }
+};
+
+struct elf64
+{
+    using ehdr = Elf64_Ehdr;
+    using shdr = Elf64_Shdr;
+    using sym = Elf64_Sym;
+    using dyn = Elf64_Dyn;
+
+    static unsigned char bind(unsigned char info)
+    { return ELF64_ST_BIND(info); }
+
+    static unsigned char visibility(unsigned char other)
+    { return ELF64_ST_VISIBILITY(other); }
+};
+
+// Bounds checked view of the mapped file, truncated or corrupted files
+// must not be read past their end
+class elf_view
+{
+public:
+    elf_view(const mapped_file& mf)
+    : data_(mf.data()),
+    size_(mf.size())
+    {}
+
+    template <typename T>
+    bool get(std::size_t off, T& v) const
+    {
+        if (off > size_ || sizeof(T) > size_ - off) {
+            return false;
+        }
+
+        std::memcpy(&v, data_ + off, sizeof(T));
+
+        return true;
+    }
+
+    bool in(std::size_t off, std::size_t size) const
+    { return off <= size_ && size <= size_ - off; }
+
+    // NUL terminated string of a string table section
+    template <typename Shdr>
+    std::string str(const Shdr& strtab, std::size_t off) const
+    {
+        if (off >= strtab.sh_size || !in(strtab.sh_offset, strtab.sh_size)) {
+            return {};
+        }
+
+        const char* p = data_ + strtab.sh_offset + off;
+        auto max = strtab.sh_size - off;
+
+        return std::string(p, ::strnlen(p, max));
+    }
+
+private:
+    const char* data_;
+    std::size_t size_;
+};
+
+template <typename Elf>
+bool
+read_abi(const elf_view& v, elf_abi& abi)
+{
+    typename Elf::ehdr eh;
+
+    if (!v.get(0, eh) || eh.e_type != ET_DYN) {
+        return false;
+    }
+
+    if (eh.e_shentsize != sizeof(typename Elf::shdr)) {
+        return false;
+    }
+
+    std::vector<typename Elf::shdr> shdrs(eh.e_shnum);
+
+    for (std::size_t i = 0; i < shdrs.size(); ++i) {
+        if (!v.get(eh.e_shoff + i * sizeof(typename Elf::shdr), shdrs[i])) {
+            return false;
+        }
+    }
+
+    auto link = [&](const auto& sh) -> const typename Elf::shdr* {
+        return sh.sh_link < shdrs.size() ? &shdrs[sh.sh_link] : nullptr;
+    };
+
+    for (const auto& sh : shdrs) {
+        const auto* strtab = link(sh);
+
+        if (!strtab || sh.sh_entsize == 0) {
+            continue;
+        }
+
+        auto count = sh.sh_size / sh.sh_entsize;
+
+        if (sh.sh_type == SHT_DYNSYM) {
+            // Entry 0 is the undefined symbol
+            for (std::size_t i = 1; i < count; ++i) {
+                typename Elf::sym s;
+
+                if (!v.get(sh.sh_offset + i * sh.sh_entsize, s)) {
+                    break;
+                }
+
+                auto bind = Elf::bind(s.st_info);
+
+                if (
+                    s.st_shndx == SHN_UNDEF
+                    ||
+                    (bind != STB_GLOBAL && bind != STB_WEAK)
+                    ||
+                    Elf::visibility(s.st_other) == STV_HIDDEN
+                    ||
+                    Elf::visibility(s.st_other) == STV_INTERNAL
+                ) {
+                    continue;
+                }
+
+                abi.symbols.insert(v.str(*strtab, s.st_name));
+            }
+        } else if (sh.sh_type == SHT_DYNAMIC) {
+            for (std::size_t i = 0; i < count; ++i) {
+                typename Elf::dyn d;
+
+                if (
+                    !v.get(sh.sh_offset + i * sh.sh_entsize, d)
+                    ||
+                    d.d_tag == DT_NULL
+                ) {
+                    break;
+                }
+
+                if (d.d_tag == DT_SONAME) {
+                    abi.soname = v.str(*strtab, d.d_un.d_val);
+                }
+            }
+        }
+    }
+
+    return true;
+}
+
+}
+
+bool
+read_elf_abi(const std::string& file, elf_abi& abi)
+{
+    mapped_file mf(file);
+    detail::elf_view v(mf);
+    unsigned char ident[EI_NIDENT];
+
+    if (
+        !v.get(0, ident)
+        ||
+        std::memcmp(ident, ELFMAG, SELFMAG) != 0
+    ) {
+        return false;
+    }
+
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    if (ident[EI_DATA] != ELFDATA2LSB) {
+        return false;
+    }
+#else
+    if (ident[EI_DATA] != ELFDATA2MSB) {
+        return false;
+    }
+#endif
+
+    abi = elf_abi{};
+
+    switch (ident[EI_CLASS]) {
+        case ELFCLASS32:
+        return detail::read_abi<detail::elf32>(v, abi);
+        case ELFCLASS64:
+        return detail::read_abi<detail::elf64>(v, abi);
+    }
+
+    return false;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// ABI comparison
+//
+///////////////////////////////////////////////////////////////////////////////
+bool
+abi_diff::compatible() const
+{ return old_soname == new_soname && removed.empty(); }
+
+abi_diff
+diff_abi(const elf_abi& from, const elf_abi& to)
+{
+    abi_diff d{ from.soname, to.soname };
+
+    for (const auto& s : to.symbols) {
+        if (!from.symbols.contains(s)) {
+            d.added.push_back(s);
+        }
+    }
+
+    for (const auto& s : from.symbols) {
+        if (!to.symbols.contains(s)) {
+            d.removed.push_back(s);
+        }
+    }
+
+    return d;
+}
+
+}
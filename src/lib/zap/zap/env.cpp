@@ -1,13 +1,29 @@
+#include <algorithm>
 #include <filesystem>
 
 #include <zap/env.hpp>
 #include <zap/archiver.hpp>
+#include <zap/digest.hpp>
 #include <zap/scope.hpp>
 #include <zap/log.hpp>
 #include <zap/utils.hpp>
+#include <zap/url.hpp>
 
 namespace zap {
 
+// Touched on each use of a work directory, for LRU pruning
+static const std::string work_marker = ".zap-work";
+// Archive digest characters in work directory names
+static const std::size_t work_digest_size = 16;
+static const std::string default_work_max_size = "20G";
+// Git repositories are given as git+<repo>#<ref>
+static const std::string git_prefix = "git+";
+
+// Names of files shared by zap processes, whatever their build
+static std::string
+hash_key(const std::string& s)
+{ return digest_key(s); }
+
 env::env(const env_opts& opts)
 : opts_(opts),
 sys_db_ptr_(new_sys_db())
@@ -56,6 +72,10 @@ zap::executor&
 env::executor() const
 { return *executor_ptr_; }
 
+std::size_t
+env::jobs() const
+{ return adjust_par_level(executor(), 0); }
+
 const zap::os_info&
 env::os_info() const
 { return os_info_; }
@@ -69,63 +89,302 @@ env::fetcher() const
 { return *fetcher_ptr_; }
 
 archive_info
-env::download_archive(const std::string& url) const
+env::fetch_archive(
+    const std::string& url,
+    const std::string& digest
+) const
 {
     scope s;
     archive_info ai{url};
-    env_db_archive ar;
-    bool download_needed = true;
+    env_db_archive ar{url};
+
+    if (url.starts_with(git_prefix)) {
+        // The mirror is the archive store of repositories
+        auto pos = url.find('#');
+
+        if (pos != std::string::npos) {
+            fetcher().fetch_repo(
+                url.substr(git_prefix.size(), pos - git_prefix.size()),
+                url.substr(pos + 1)
+            );
+        }
+
+        return ai;
+    }
+
+    die_unless(
+        digest.empty() || valid_digest(digest),
+        "invalid digest for ", url, ": ", digest
+    );
 
     const auto& archives_dir = paths_["archives"];
 
     mkpath(archives_dir);
 
-    if (env_db().has_archive(url, ar)) {
+    // Concurrent runs wait for the first download and reuse it
+    auto l = lock("download", url);
+
+    if (
+        env_db().has_archive(url, ar)
+        &&
+        file_exists(cat_file(archives_dir, ar.file))
+    ) {
         ai.file = cat_file(archives_dir, ar.file);
 
-        download_needed = !file_exists(ai.file);
+        // Archives stored by older versions are hashed once
+        if (ar.digest.empty()) {
+            ar.digest = digest_file("sha256", ai.file);
+            env_db().add_archive(ar);
+        }
+
+        // Recorded digests are trusted as long as the file is there
+        ai.digest = ar.digest;
+
+        if (!digest.empty()) {
+            // Pinned contents can't change, whatever the URL
+            if (check_archive(ai, ar, digest)) {
+                return ai;
+            }
+
+            warn(url, " does not match ", digest, ", downloading it again");
+            ar = env_db_archive{ url };
+        } else if (
+            fetcher().immutable(url)
+            ||
+            // Without validators, there's no telling whether it changed
+            (ar.etag.empty() && ar.last_modified.empty())
+        ) {
+            return ai;
+        }
+    } else {
+        ar = env_db_archive{ url };
     }
 
-    if (download_needed) {
-        download_archive(s, ai);
+    download_archive(s, ai, ar, digest);
+
+    return ai;
+}
+
+archive_info
+env::download_archive(
+    const std::string& url,
+    const std::string& digest
+) const
+{
+    scope s;
+
+    if (url.starts_with(git_prefix)) {
+        archive_info ai{url};
+
+        download_repo(s, ai);
+
+        return ai;
     }
 
+    auto ai = fetch_archive(url, digest);
+
     extract_archive(s, ai);
 
     return ai;
 }
 
 void
-env::download_archive(scope& s, archive_info& ai) const
+env::prepare_work(const archive_info& ai, bool fresh) const
 {
-    const auto& archives_dir = paths_["archives"];
+    if (fresh) {
+        rmpath(cat_dir(ai.dir, "build"));
+    }
 
-    set_temp_dir(s, ai);
+    // Staged files of a previous build must not end up in the manifest
+    rmpath(cat_dir(ai.dir, "stage"));
 
-    // TOFIX fetcher().download(ai.url, ai.temp_dir);
+    touch_file(cat_file(ai.dir, work_marker));
+}
 
-    auto [ dlok, file ] = unique_file(ai.temp_dir);
+void
+env::prune_work(const std::string& keep) const
+{
+    const char* max_size_expr = std::getenv("ZAP_WORK_MAX_SIZE");
 
-    die_unless(
-        dlok,
-        "unable to find dowloaded file in: ", ai.temp_dir
+    auto max_size = human_readable_size(
+        max_size_expr != nullptr
+        ? std::string{ max_size_expr }
+        : default_work_max_size
     );
 
+    struct work_dir
+    {
+        std::string dir;
+        std::size_t size;
+        std::size_t used;
+    };
+
+    std::vector<work_dir> dirs;
+    std::size_t total = 0;
+
+    for (const auto& name : find_dirs(paths_["work"])) {
+        auto dir = cat_dir(paths_["work"], name);
+        auto size = dir_size(dir);
+        auto used = file_mtime(cat_file(dir, work_marker));
+
+        total += size;
+
+        if (dir != keep) {
+            dirs.emplace_back(dir, size, used);
+        }
+    }
+
+    std::sort(
+        dirs.begin(), dirs.end(),
+        [](const auto& a, const auto& b) { return a.used < b.used; }
+    );
+
+    for (const auto& wd : dirs) {
+        if (total <= max_size) {
+            break;
+        }
+
+        auto l = lock("build", wd.dir, false);
+
+        if (!l.owns_lock()) {
+            continue;
+        }
+
+        log("removing work directory ", wd.dir);
+        rmpath(wd.dir);
+        total -= wd.size;
+    }
+}
+
+file_lock
+env::lock(
+    const std::string& kind,
+    const std::string& key,
+    bool wait
+) const
+{
+    return file_lock(
+        cat_file(paths_["locks"], cat(kind, '-', hash_key(key), ".lock")),
+        wait
+    );
+}
+
+void
+env::download_archive(
+    scope& s,
+    archive_info& ai,
+    const env_db_archive& known,
+    const std::string& digest
+) const
+{
+    const auto& archives_dir = paths_["archives"];
+
+    // Partial downloads are kept under a stable name so that the next run
+    // resumes them
+    auto uri = zap::url(ai.url).uri;
+    auto name = basename(uri.substr(0, uri.find('?')));
+    auto file = cat(hash_key(ai.url), '-', name);
+    auto partial_dir = cat_dir(archives_dir, "partial");
+
+    auto di = fetcher().download(
+        ai.url,
+        partial_dir,
+        file,
+        download_info{
+            known.etag,
+            known.last_modified,
+            known.size,
+            known.digest
+        },
+        digest
+    );
+
+    if (!di.modified) {
+        log(ai.url, " not modified");
+        ai.digest = known.digest;
+        return;
+    }
+
     ai.file = cat_file(archives_dir, file);
+    ai.verified = !digest.empty();
+
+    rename(cat_file(partial_dir, file), ai.file);
+
+    env_db_archive ar{
+        ai.url,
+        file,
+        di.etag,
+        di.last_modified,
+        di.size,
+        di.digest
+    };
+
+    // Work directories are keyed on the SHA-256 of the archive, computed
+    // once more when downloads were verified with another algorithm
+    if (digest_algo(di.digest) != "sha256") {
+        ar.pinned = di.digest;
+        ar.digest = digest_file("sha256", ai.file);
+    }
 
-    rename(cat_file(ai.temp_dir, file), ai.file);
+    ai.digest = ar.digest;
 
-    env_db().add_archive(env_db_archive{ ai.url, file });
+    env_db().add_archive(ar);
+}
+
+bool
+env::check_archive(
+    archive_info& ai,
+    env_db_archive& ar,
+    const std::string& digest
+) const
+{
+    auto algo = digest_algo(digest);
+
+    ai.digest = ar.digest;
+
+    if (algo == "sha256") {
+        ai.verified = ar.digest == digest;
+        return ai.verified;
+    }
+
+    // Recorded digests are trusted, files are only hashed when pinned
+    // with another digest
+    if (ar.pinned != digest && digest_file(algo, ai.file) == digest) {
+        ar.pinned = digest;
+        env_db().add_archive(ar);
+    }
+
+    ai.verified = ar.pinned == digest;
+
+    return ai.verified;
 }
 
 void
 env::extract_archive(scope& s, archive_info& ai) const
 {
+    // Always SHA-256, the same archive gets the same work directory
+    // however it was pinned
+    auto digest = (
+        ai.digest.empty()
+        ? sha256_file(ai.file)
+        : digest_hex(ai.digest)
+    ).substr(0, work_digest_size);
+    auto l = lock("extract", digest);
+
+    if (find_work_dir(ai, digest)) {
+        return;
+    }
+
     set_temp_dir(s, ai);
 
     archiver ar(paths_, ai.file);
 
-    ar.verify();
+    // Pinned archives are known to be intact, skip the test pass
+    // (e.g. unzip -t)
+    if (!ai.verified) {
+        ar.verify();
+    }
+
     ar.extract(ai.temp_dir);
 
     auto [ exok, dir ] = unique_dir(ai.temp_dir);
@@ -142,7 +401,59 @@ env::extract_archive(scope& s, archive_info& ai) const
         "unable to extract name and version from: ", dir
     );
 
-    ai.dir = cat_dir(paths_["work"], dir);
+    ai.name = dir.substr(0, pos);
+    ai.version = dir.substr(pos + 1);
+
+    make_work_dir(ai, cat_dir(ai.temp_dir, dir), digest);
+}
+
+void
+env::download_repo(scope& s, archive_info& ai) const
+{
+    auto pos = ai.url.find('#');
+
+    die_if(
+        pos == std::string::npos,
+        "missing ref in git URL (git+<repo>#<ref>): ", ai.url
+    );
+
+    auto repo = ai.url.substr(git_prefix.size(), pos - git_prefix.size());
+    auto ref = ai.url.substr(pos + 1);
+    auto commit = fetcher().fetch_repo(repo, ref);
+    auto digest = commit.substr(0, work_digest_size);
+    auto l = lock("extract", digest);
+
+    if (find_work_dir(ai, digest)) {
+        return;
+    }
+
+    set_temp_dir(s, ai);
+
+    auto src = cat_dir(ai.temp_dir, "src");
+
+    fetcher().checkout_repo(repo, commit, src);
+
+    // Work directory names are <name>-<version>-<digest>
+    ai.name = basename(repo, ".git");
+    ai.version = ref;
+
+    std::replace(ai.version.begin(), ai.version.end(), '/', '_');
+    std::replace(ai.version.begin(), ai.version.end(), '-', '_');
+
+    make_work_dir(ai, src, digest);
+}
+
+void
+env::make_work_dir(
+    archive_info& ai,
+    const std::string& src,
+    const std::string& digest
+) const
+{
+    ai.dir = cat_dir(
+        paths_["work"],
+        cat(ai.name, '-', ai.version, '-', digest)
+    );
 
     if (directory_exists(ai.dir)) {
         rmpath(ai.dir);
@@ -150,11 +461,46 @@ env::extract_archive(scope& s, archive_info& ai) const
 
     mkpath(ai.dir);
 
-    ai.name = dir.substr(0, pos);
-    ai.version = dir.substr(pos + 1);
     ai.source_dir = cat_dir(ai.dir, "src");
 
-    rename(cat_dir(ai.temp_dir, dir), ai.source_dir);
+    rename(src, ai.source_dir);
+
+    touch_file(cat_file(ai.dir, work_marker));
+}
+
+bool
+env::find_work_dir(archive_info& ai, const std::string& digest) const
+{
+    auto suffix = cat('-', digest);
+
+    for (const auto& name : find_dirs(paths_["work"])) {
+        auto dir = cat_dir(paths_["work"], name);
+
+        // The marker is only written once extraction has completed
+        if (
+            !name.ends_with(suffix)
+            ||
+            !file_exists(cat_file(dir, work_marker))
+        ) {
+            continue;
+        }
+
+        auto pkg = name.substr(0, name.size() - suffix.size());
+        auto pos = pkg.rfind('-');
+
+        if (pos == std::string::npos) {
+            continue;
+        }
+
+        ai.dir = dir;
+        ai.name = pkg.substr(0, pos);
+        ai.version = pkg.substr(pos + 1);
+        ai.source_dir = cat_dir(ai.dir, "src");
+
+        return true;
+    }
+
+    return false;
 }
 
 void
@@ -187,6 +533,7 @@ env::init()
     paths_.sm.emplace("archives", (buildp / "archives").string());
     paths_.sm.emplace("work", (buildp / "work").string());
     paths_.sm.emplace("tmp", (buildp / "tmp").string());
+    paths_.sm.emplace("locks", (buildp / "locks").string());
 
     env_db_ptr_ = new_env_db(paths_["root"]);
     executor_ptr_ = std::make_unique<zap::executor>();
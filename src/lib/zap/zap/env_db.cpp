@@ -1,11 +1,34 @@
+#include <algorithm>
+#include <utility>
+
 #include <zap/env_db.hpp>
 #include <zap/utils.hpp>
 #include <zap/db/dbi.hpp>
 
 namespace zap {
 
+// Installed files are stored as (interned directory, name)
+static std::pair<std::string, std::string>
+split_file(const std::string& file)
+{
+    auto pos = file.rfind('/');
+
+    if (pos == std::string::npos) {
+        return { std::string{}, file };
+    }
+
+    return { file.substr(0, pos), file.substr(pos + 1) };
+}
+
+static std::string
+join_file(const std::string& dir, const std::string& name)
+{ return dir.empty() ? name : cat_file(dir, name); }
+
 struct env_db_spec
 {
+    // Bumped on schema changes
+    static constexpr int version = 6;
+
     static auto make(const std::string& file)
     {
         using namespace sqlite_orm;
@@ -17,15 +40,45 @@ struct env_db_spec
                 make_column("name", &env_db_pkg::name, primary_key()),
                 make_column("version", &env_db_pkg::version)
             ).without_rowid(),
+            make_index("pkg_files_pkg", &env_db_file::pkg),
+            make_table(
+                "dirs",
+                make_column("id", &env_db_dir::id, primary_key()),
+                make_column("path", &env_db_dir::path, unique())
+            ),
             make_table(
                 "pkg_files",
-                make_column("pkg", &env_db_pkg_file::pkg, primary_key()),
-                make_column("file", &env_db_pkg_file::file)
+                make_column("dir_id", &env_db_file::dir_id),
+                make_column("name", &env_db_file::name),
+                make_column("pkg", &env_db_file::pkg),
+                primary_key(&env_db_file::dir_id, &env_db_file::name)
             ).without_rowid(),
             make_table(
                 "archives",
                 make_column("url", &env_db_archive::url, primary_key()),
-                make_column("file", &env_db_archive::file)
+                make_column("file", &env_db_archive::file),
+                make_column("etag", &env_db_archive::etag),
+                make_column(
+                    "last_modified",
+                    &env_db_archive::last_modified
+                ),
+                make_column("size", &env_db_archive::size),
+                make_column("digest", &env_db_archive::digest),
+                make_column("pinned", &env_db_archive::pinned)
+            ).without_rowid(),
+            make_table(
+                "build_times",
+                make_column("pkg", &env_db_build_time::pkg, primary_key()),
+                make_column("configure_ms", &env_db_build_time::configure_ms),
+                make_column("build_ms", &env_db_build_time::build_ms)
+            ).without_rowid(),
+            make_table(
+                "synced",
+                make_column("name", &env_db_synced::name, primary_key()),
+                make_column("url", &env_db_synced::url),
+                make_column("pkg", &env_db_synced::pkg),
+                make_column("own", &env_db_synced::own),
+                make_column("inputs", &env_db_synced::inputs)
             ).without_rowid()
         );
     }
@@ -33,6 +86,80 @@ struct env_db_spec
 
 using dbi = zap::db::dbi<env_db_spec>;
 
+///////////////////////////////////////////////////////////////////////////////
+//
+// Prepared statements of hot queries
+//
+///////////////////////////////////////////////////////////////////////////////
+static auto
+prepare_archive(dbi::db_type& db)
+{
+    using namespace sqlite_orm;
+
+    return db.prepare(
+        get_all<env_db_archive>(
+            where(c(&env_db_archive::url) == std::string{})
+        )
+    );
+}
+
+static auto
+prepare_package(dbi::db_type& db)
+{
+    using namespace sqlite_orm;
+
+    return db.prepare(
+        get_all<env_db_pkg>(
+            where(c(&env_db_pkg::name) == std::string{})
+        )
+    );
+}
+
+static auto
+prepare_file_owner(dbi::db_type& db)
+{
+    using namespace sqlite_orm;
+
+    // Unique index on the directory, primary key on the file
+    return db.prepare(
+        select(
+            &env_db_file::pkg,
+            inner_join<env_db_dir>(
+                on(c(&env_db_dir::id) == &env_db_file::dir_id)
+            ),
+            where(
+                c(&env_db_dir::path) == std::string{}
+                &&
+                c(&env_db_file::name) == std::string{}
+            )
+        )
+    );
+}
+
+template <typename Prepare>
+using prepared_type = zap::db::prepared<
+    decltype(std::declval<Prepare>()(std::declval<dbi::db_type&>()))
+>;
+
+struct env_db_statements
+{
+    env_db_statements(dbi::db_type& db)
+    : archive(prepare_archive(db)),
+    package(prepare_package(db)),
+    file_owner(prepare_file_owner(db))
+    {}
+
+    prepared_type<decltype(&prepare_archive)> archive;
+    prepared_type<decltype(&prepare_package)> package;
+    prepared_type<decltype(&prepare_file_owner)> file_owner;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Environment database
+//
+///////////////////////////////////////////////////////////////////////////////
+
 // Note: early declaration of private method so the concrete types can be
 // deduced
 auto&
@@ -65,8 +192,9 @@ env_db::init(const std::string& dir)
 
     db_ptr_ = dbi::new_storage(db_file);
 
-    db().open_forever();
-    db().sync_schema();
+    dbi().open();
+
+    stmts_ = std::make_unique<env_db_statements>(db());
 }
 
 env_db_pkgs
@@ -87,22 +215,157 @@ env_db::packages()
     return pkgs;
 }
 
+env_db_pkg_file_list
+env_db::package_files(const std::string& name)
+{
+    env_db_pkg_file_list files;
+
+    auto tx_cb = [&](zap::scope& scope) {
+        using namespace sqlite_orm;
+
+        auto rows = db().select(
+            columns(&env_db_dir::path, &env_db_file::name),
+            inner_join<env_db_dir>(
+                on(c(&env_db_dir::id) == &env_db_file::dir_id)
+            ),
+            where(c(&env_db_file::pkg) == name)
+        );
+
+        files.reserve(rows.size());
+
+        for (const auto& r : rows) {
+            files.emplace_back(
+                env_db_pkg_file{
+                    name,
+                    join_file(std::get<0>(r), std::get<1>(r))
+                }
+            );
+        }
+    };
+
+    dbi().exec_read(tx_cb);
+
+    return files;
+}
+
 bool
-env_db::has_archive(const std::string& url, env_db_archive& ar)
+env_db::file_owner(const std::string& file, std::string& pkg)
+{
+    bool ret = false;
+    auto [ dir, name ] = split_file(file);
+
+    auto tx_cb = [&](zap::scope& scope) {
+        stmts_->file_owner.with([&](auto& stmt) {
+            using namespace sqlite_orm;
+
+            get<0>(stmt) = dir;
+            get<1>(stmt) = name;
+
+            auto rows = db().execute(stmt);
+
+            if (rows.size() == 1) {
+                ret = true;
+                pkg = rows.front();
+            }
+        });
+    };
+
+    dbi().exec_read(tx_cb);
+
+    return ret;
+}
+
+bool
+env_db::has_package(const std::string& name, env_db_pkg& pkg)
 {
     bool ret = false;
 
+    auto tx_cb = [&](zap::scope& scope) {
+        stmts_->package.with([&](auto& stmt) {
+            using namespace sqlite_orm;
+
+            get<0>(stmt) = name;
+
+            auto rows = db().execute(stmt);
+
+            if (rows.size() == 1) {
+                ret = true;
+                pkg = rows.front();
+            }
+        });
+    };
+
+    dbi().exec_read(tx_cb);
+
+    return ret;
+}
+
+void
+env_db::set_package(const env_db_pkg& pkg, const strings& files)
+{
     auto tx_cb = [&](zap::scope& scope) {
         using namespace sqlite_orm;
 
-        auto rows = db().get_all<env_db_archive>(
-            where(c(&env_db_archive::url) == url)
+        db().replace(pkg);
+        db().remove_all<env_db_file>(
+            where(c(&env_db_file::pkg) == pkg.name)
         );
 
-        if (rows.size() == 1) {
-            ret = true;
-            ar = rows.front();
+        dir_ids ids;
+        std::vector<env_db_file> rows;
+
+        rows.reserve(files.size());
+
+        for (const auto& file : files) {
+            auto [ dir, name ] = split_file(file);
+
+            // Files of other packages change owner
+            rows.emplace_back(
+                env_db_file{ intern_dir(dir, ids), std::move(name), pkg.name }
+            );
         }
+
+        dbi().replace_range(rows.begin(), rows.end());
+    };
+
+    dbi().exec_write(tx_cb);
+}
+
+void
+env_db::remove_package(const std::string& name)
+{
+    auto tx_cb = [&](zap::scope& scope) {
+        using namespace sqlite_orm;
+
+        db().remove_all<env_db_file>(
+            where(c(&env_db_file::pkg) == name)
+        );
+        db().remove_all<env_db_pkg>(
+            where(c(&env_db_pkg::name) == name)
+        );
+    };
+
+    dbi().exec_write(tx_cb);
+}
+
+bool
+env_db::has_archive(const std::string& url, env_db_archive& ar)
+{
+    bool ret = false;
+
+    auto tx_cb = [&](zap::scope& scope) {
+        stmts_->archive.with([&](auto& stmt) {
+            using namespace sqlite_orm;
+
+            get<0>(stmt) = url;
+
+            auto rows = db().execute(stmt);
+
+            if (rows.size() == 1) {
+                ret = true;
+                ar = rows.front();
+            }
+        });
     };
 
     dbi().exec_read(tx_cb);
@@ -113,15 +376,100 @@ env_db::has_archive(const std::string& url, env_db_archive& ar)
 void
 env_db::add_archive(const env_db_archive& ar)
 {
+    // Archives whose file went missing are downloaded again
+    auto tx_cb = [&](zap::scope& scope) { db().replace(ar); };
+
+    dbi().exec_write(tx_cb);
+}
+
+env_db_build_times
+env_db::build_times()
+{
+    env_db_build_times bts;
+
     auto tx_cb = [&](zap::scope& scope) {
-        dbi().ensure_not_exists<env_db_archive>(
-            "archive", &env_db_archive::url, ar.url
+        using namespace sqlite_orm;
+
+        bts = db().get_all<env_db_build_time>(
+            order_by(&env_db_build_time::pkg)
         );
+    };
+
+    dbi().exec_read(tx_cb);
+
+    return bts;
+}
+
+void
+env_db::set_build_time(const env_db_build_time& bt)
+{
+    auto tx_cb = [&](zap::scope& scope) {
+        db().replace(bt);
+    };
+
+    dbi().exec_write(tx_cb);
+}
+
+env_db_synceds
+env_db::synced()
+{
+    env_db_synceds ss;
+
+    auto tx_cb = [&](zap::scope& scope) {
+        ss = db().get_all<env_db_synced>();
+    };
+
+    dbi().exec_read(tx_cb);
+
+    return ss;
+}
+
+void
+env_db::set_synced(const env_db_synced& s)
+{
+    auto tx_cb = [&](zap::scope& scope) { db().replace(s); };
+
+    dbi().exec_write(tx_cb);
+}
+
+void
+env_db::remove_synced(const std::string& name)
+{
+    auto tx_cb = [&](zap::scope& scope) {
+        using namespace sqlite_orm;
 
-        db().insert(ar);
+        db().remove_all<env_db_synced>(
+            where(c(&env_db_synced::name) == name)
+        );
     };
 
     dbi().exec_write(tx_cb);
 }
 
+std::int64_t
+env_db::intern_dir(const std::string& dir, dir_ids& ids)
+{
+    auto it = ids.find(dir);
+
+    if (it != ids.end()) {
+        return it->second;
+    }
+
+    using namespace sqlite_orm;
+
+    std::int64_t id;
+
+    auto rows = db().get_all<env_db_dir>(where(c(&env_db_dir::path) == dir));
+
+    if (rows.empty()) {
+        id = db().insert(env_db_dir{ 0, dir });
+    } else {
+        id = rows.front().id;
+    }
+
+    ids.emplace(dir, id);
+
+    return id;
+}
+
 }
@@ -1,73 +1,195 @@
-#include <fstream>
+#include <sstream>
 
-#define CPPHTTPLIB_OPENSSL_SUPPORT
-#include <httplib.h>
+#include <re2/re2.h>
 
 #include <zap/fetcher.hpp>
+#include <zap/downloader.hpp>
+#include <zap/digest.hpp>
+#include <zap/git_mirror.hpp>
 #include <zap/utils.hpp>
 #include <zap/log.hpp>
 #include <zap/url.hpp>
 
 namespace zap {
 
+static const std::string file_scheme = "file://";
+
 fetcher::fetcher(const env_paths& ep)
 : ep_(ep)
-{}
+{
+    const char* mirrors = std::getenv("ZAP_MIRRORS");
+
+    if (mirrors != nullptr) {
+        std::istringstream iss(mirrors);
+
+        for (std::string m; iss >> m; ) {
+            while (m.size() > 1 && m.ends_with('/')) {
+                m.pop_back();
+            }
+
+            mirrors_.emplace_back(std::move(m));
+        }
+    }
+}
 
 fetcher::~fetcher()
 {}
 
-void
+download_info
 fetcher::download(
     const std::string& url,
     const std::string& dir,
-    const std::string& filename
+    const std::string& filename,
+    const download_info& known,
+    const std::string& digest
 ) const
 {
     mkpath(dir);
 
     auto file = cat_file(dir, filename);
+    download_info di;
+
+    // Local archives are mirrors of their own
+    if (url.starts_with(file_scheme)) {
+        die_unless(
+            fetch(url, file, digest, di),
+            "file not found: ", url.substr(file_scheme.size())
+        );
+
+        return di;
+    }
+
+    if (!mirrors_.empty()) {
+        auto path = mirror_path(url);
+
+        for (const auto& m : mirrors_) {
+            try {
+                if (fetch(cat(m, '/', path), file, digest, di)) {
+                    log("fetched ", url, " from mirror ", m);
+
+                    return di;
+                }
+            } catch (const std::exception& e) {
+                warn("mirror ", m, " failed: ", e.what());
+            }
+        }
+    }
+
+    download_opts opts;
+
+    opts.connections = env_setting(
+        "ZAP_DOWNLOAD_CONNECTIONS",
+        opts.connections
+    );
+    opts.digest = digest;
 
-    std::ofstream ofs(file, std::ios::binary);
+    return downloader(url, file, opts, known).run();
+}
 
-    die_if(!ofs, "failed to open file: ", file);
+const strings&
+fetcher::mirrors() const
+{ return mirrors_; }
 
+std::string
+fetcher::mirror_path(const std::string& url)
+{
     zap::url u(url);
 
     die_unless(u.parsed, "invalid url: ", url);
 
-    httplib::Client c(u.host());
+    auto uri = u.uri.substr(0, u.uri.find('?'));
 
-    c.set_follow_location(true);
+    while (uri.starts_with('/')) {
+        uri.erase(0, 1);
+    }
 
-    // TOFIX: need to find a better way to fix this
-    c.enable_server_certificate_verification(false);
+    // file:///srv/a.zip has no host
+    return u.hostname.empty() ? uri : cat_file(u.hostname, uri);
+}
 
-    auto res = c.Get(
-        u.uri,
-        [&] (const char* data, size_t size) {
-            ofs.write(data, size);
+bool
+fetcher::fetch(
+    const std::string& from,
+    const std::string& file,
+    const std::string& digest,
+    download_info& di
+) const
+{
+    if (!from.starts_with(file_scheme) && !from.starts_with('/')) {
+        // HTTP mirrors: missing archives fail the download
+        download_opts opts;
+
+        opts.digest = digest;
+
+        di = downloader(from, file, opts).run();
+    } else {
+        auto path =
+            from.starts_with(file_scheme)
+            ? from.substr(file_scheme.size())
+            : from
+            ;
+
+        if (!file_exists(path) || !copy_file(path, file)) {
+            return false;
+        }
 
-            die_if(!ofs, "failed write file: ", file);
+        di.size = file_size(file);
+        di.digest = digest_file(
+            digest.empty() ? "sha256" : digest_algo(digest),
+            file
+        );
 
-            return true;
+        if (!digest.empty() && di.digest != digest) {
+            rmfile(file);
+
+            die(
+                "digest mismatch for ", from, ": expected ", digest,
+                ", got ", di.digest
+            );
         }
-    );
+    }
 
-    die_if(
-        !res,
-        "HTTP error while downloading file: ",
-        file,
-        httplib::to_string(res.error())
+    // Local and mirrored archives are never revalidated upstream
+    di.etag.clear();
+    di.last_modified.clear();
+
+    return true;
+}
+
+bool
+fetcher::immutable(const std::string& url) const
+{
+    // Tags, releases and commits, e.g.:
+    // https://github.com/a/b/archive/refs/tags/v1.2.3.tar.gz
+    // https://github.com/a/b/archive/v1.2.3.tar.gz
+    // https://github.com/a/b/releases/download/v1.2/b-1.2.tar.xz
+    // https://gitlab.com/a/b/-/archive/v1.2.3/b-v1.2.3.tar.gz
+    static const re2::RE2 tag_re(
+        R"(.*/(?:refs/tags/|releases/download/|(?:-/)?archive/)"
+        R"((?:v?\d+(?:\.\d+)+|[0-9a-f]{40})[/.-].*)"
     );
+
+    return re2::RE2::FullMatch(url, tag_re);
 }
 
+std::string
+fetcher::fetch_repo(const std::string& repo, const std::string& ref) const
+{ return git_mirror(repo).fetch(ref); }
+
+void
+fetcher::checkout_repo(
+    const std::string& repo,
+    const std::string& commit,
+    const std::string& dir
+) const
+{ git_mirror(repo).checkout(commit, dir); }
+
 void
 fetcher::download_repo_archive(
     const std::string& repo,
     const std::string& ref,
     const std::string& dir
 ) const
-{}
+{ checkout_repo(repo, fetch_repo(repo, ref), dir); }
 
 }
@@ -0,0 +1,81 @@
+#include <cerrno>
+
+#include <sys/file.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <zap/file_lock.hpp>
+#include <zap/utils.hpp>
+#include <zap/log.hpp>
+
+namespace zap {
+
+file_lock::file_lock(const std::string& path, bool wait)
+: path_(path)
+{
+    mkfilepath(path_);
+
+    fd_ = ::open(path_.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+
+    sysdie_if(fd_ == -1, "failed to open lock file: ", path_);
+
+    if (::flock(fd_, LOCK_EX | LOCK_NB) == 0) {
+        return;
+    }
+
+    auto err = errno;
+
+    if (err != EWOULDBLOCK || !wait) {
+        ::close(fd_);
+        fd_ = -1;
+
+        errno = err;
+        sysdie_if(err != EWOULDBLOCK, "failed to lock ", path_);
+
+        return;
+    }
+
+    log("waiting for another zap process (", path_, ")");
+
+    int rc;
+
+    do {
+        rc = ::flock(fd_, LOCK_EX);
+    } while (rc == -1 && errno == EINTR);
+
+    if (rc == -1) {
+        ::close(fd_);
+        fd_ = -1;
+        sysdie("failed to lock ", path_);
+    }
+}
+
+file_lock::file_lock(file_lock&& other)
+: path_(std::move(other.path_)),
+fd_(other.fd_)
+{ other.fd_ = -1; }
+
+file_lock::~file_lock()
+{ unlock(); }
+
+const std::string&
+file_lock::path() const
+{ return path_; }
+
+bool
+file_lock::owns_lock() const
+{ return fd_ != -1; }
+
+void
+file_lock::unlock()
+{
+    if (fd_ == -1) {
+        return;
+    }
+
+    // Closing the last descriptor releases the lock
+    ::close(fd_);
+    fd_ = -1;
+}
+
+}
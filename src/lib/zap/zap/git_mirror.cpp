@@ -0,0 +1,267 @@
+#include <git2.h>
+
+#include <zap/git_mirror.hpp>
+#include <zap/digest.hpp>
+#include <zap/file_lock.hpp>
+#include <zap/scope.hpp>
+#include <zap/utils.hpp>
+#include <zap/log.hpp>
+
+namespace zap {
+
+namespace detail {
+
+struct git_library
+{
+    git_library()
+    { git_libgit2_init(); }
+
+    ~git_library()
+    { git_libgit2_shutdown(); }
+};
+
+void
+git_init()
+{ static git_library lib; }
+
+template <typename... Args>
+void
+git_check(int rc, Args&&... args)
+{
+    if (rc >= 0) {
+        return;
+    }
+
+    const auto* e = git_error_last();
+
+    die(
+        std::forward<Args>(args)..., ": ",
+        e != nullptr && e->message != nullptr ? e->message : "unknown error"
+    );
+}
+
+git_repository*
+git_open(const std::string& dir)
+{
+    git_repository* r = nullptr;
+
+    if (directory_exists(dir)) {
+        git_check(
+            git_repository_open_bare(&r, dir.c_str()),
+            "failed to open git mirror ", dir
+        );
+    } else {
+        git_check(
+            git_repository_init(&r, dir.c_str(), 1),
+            "failed to create git mirror ", dir
+        );
+    }
+
+    return r;
+}
+
+bool
+is_commit_id(const std::string& ref)
+{
+    return
+        ref.size() == GIT_OID_HEXSZ
+        &&
+        ref.find_first_not_of("0123456789abcdef") == std::string::npos
+        ;
+}
+
+std::string
+to_string(const git_oid* oid)
+{
+    char buf[GIT_OID_HEXSZ + 1];
+
+    git_oid_tostr(buf, sizeof(buf), oid);
+
+    return buf;
+}
+
+}
+
+git_mirror::git_mirror(const std::string& repo)
+: repo_(repo)
+{
+    // Shared by all zap builds, the name must not depend on them
+    dir_ = cat_dir(
+        home_directory(),
+        ".cache", "zap", "git",
+        cat(basename(repo_, ".git"), '-', digest_key(repo_), ".git")
+    );
+
+    detail::git_init();
+}
+
+git_mirror::~git_mirror()
+{}
+
+std::string
+git_mirror::fetch(const std::string& ref) const
+{
+    // Concurrent zap processes share the mirror
+    file_lock l(cat(dir_, ".lock"));
+    scope s;
+
+    mkfilepath(dir_);
+
+    auto* r = detail::git_open(dir_);
+
+    s.push([r] { git_repository_free(r); });
+
+    git_odb* odb = nullptr;
+
+    detail::git_check(git_repository_odb(&odb, r), "no object database");
+    s.push([odb] { git_odb_free(odb); });
+
+    git_remote* remote = nullptr;
+
+    detail::git_check(
+        git_remote_create_anonymous(&remote, r, repo_.c_str()),
+        "invalid git repository ", repo_
+    );
+    s.push([remote] { git_remote_free(remote); });
+
+    git_remote_callbacks cbs = GIT_REMOTE_CALLBACKS_INIT;
+
+    detail::git_check(
+        git_remote_connect(
+            remote, GIT_DIRECTION_FETCH, &cbs, nullptr, nullptr
+        ),
+        "failed to connect to ", repo_
+    );
+
+    const git_remote_head** heads = nullptr;
+    std::size_t count = 0;
+    std::string refspec;
+    git_oid oid;
+    const std::string tag = cat("refs/tags/", ref);
+    const std::string branch = cat("refs/heads/", ref);
+
+    detail::git_check(
+        git_remote_ls(&heads, &count, remote),
+        "failed to list refs of ", repo_
+    );
+
+    for (const auto* name : { &tag, &branch }) {
+        for (std::size_t i = 0; i < count && refspec.empty(); ++i) {
+            if (*name == heads[i]->name) {
+                refspec = cat('+', *name, ':', *name);
+                oid = heads[i]->oid;
+            }
+        }
+    }
+
+    git_remote_disconnect(remote);
+
+    die_if(
+        refspec.empty() && !detail::is_commit_id(ref),
+        "unknown ref ", ref, " in ", repo_
+    );
+
+    if (refspec.empty()) {
+        // Commits are only reachable from refs, fetch them all once
+        git_oid_fromstr(&oid, ref.c_str());
+        refspec = "+refs/*:refs/*";
+    }
+
+    if (git_odb_exists(odb, &oid)) {
+        log(repo_, " ", ref, " already mirrored");
+    } else {
+        char* specs[] = { refspec.data() };
+        git_strarray refspecs{ specs, 1 };
+        git_fetch_options opts = GIT_FETCH_OPTIONS_INIT;
+
+        opts.download_tags = GIT_REMOTE_DOWNLOAD_TAGS_NONE;
+
+#if LIBGIT2_VER_MAJOR > 1 || LIBGIT2_VER_MINOR >= 7
+        // Tags and branches only need their tip, commits may be anywhere
+        // in the history that earlier shallow fetches cut
+        if (!detail::is_commit_id(ref)) {
+            opts.depth = 1;
+        } else if (git_repository_is_shallow(r)) {
+            opts.depth = GIT_FETCH_DEPTH_UNSHALLOW;
+        }
+#endif
+
+        log("fetching ", repo_, " ", ref);
+
+        detail::git_check(
+            git_remote_fetch(remote, &refspecs, &opts, nullptr),
+            "failed to fetch ", ref, " from ", repo_
+        );
+    }
+
+    git_object* obj = nullptr;
+    git_object* commit = nullptr;
+
+    detail::git_check(
+        git_object_lookup(&obj, r, &oid, GIT_OBJECT_ANY),
+        "unknown object ", ref, " in ", repo_
+    );
+    s.push([obj] { git_object_free(obj); });
+
+    // Annotated tags point to a tag object
+    detail::git_check(
+        git_object_peel(&commit, obj, GIT_OBJECT_COMMIT),
+        ref, " is not a commit in ", repo_
+    );
+    s.push([commit] { git_object_free(commit); });
+
+    return detail::to_string(git_object_id(commit));
+}
+
+void
+git_mirror::checkout(const std::string& commit, const std::string& dir) const
+{
+    scope s;
+
+    auto* r = detail::git_open(dir_);
+
+    s.push([r] { git_repository_free(r); });
+
+    git_oid oid;
+    git_object* obj = nullptr;
+    git_object* tree = nullptr;
+
+    detail::git_check(
+        git_oid_fromstr(&oid, commit.c_str()),
+        "invalid commit id ", commit
+    );
+
+    detail::git_check(
+        git_object_lookup(&obj, r, &oid, GIT_OBJECT_COMMIT),
+        "unknown commit ", commit, " in ", repo_
+    );
+    s.push([obj] { git_object_free(obj); });
+
+    detail::git_check(
+        git_object_peel(&tree, obj, GIT_OBJECT_TREE),
+        "no tree for commit ", commit
+    );
+    s.push([tree] { git_object_free(tree); });
+
+    mkpath(dir);
+
+    git_checkout_options opts = GIT_CHECKOUT_OPTIONS_INIT;
+
+    // Bare mirrors have no index, blobs are written to dir directly
+    opts.checkout_strategy =
+        GIT_CHECKOUT_FORCE
+        | GIT_CHECKOUT_DONT_UPDATE_INDEX
+        ;
+    opts.target_directory = dir.c_str();
+
+    detail::git_check(
+        git_checkout_tree(r, tree, &opts),
+        "failed to check out ", commit, " of ", repo_
+    );
+}
+
+const std::string&
+git_mirror::dir() const
+{ return dir_; }
+
+}
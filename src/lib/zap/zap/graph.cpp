@@ -1,6 +1,7 @@
 #include <algorithm>
 
 #include <zap/graph.hpp>
+#include <zap/csr_graph.hpp>
 
 namespace zap {
 
@@ -51,27 +52,33 @@ graph::add_edge(const std::string& from, const std::string& to)
 void
 graph::build()
 {
-    // Please see:
-    //
-    // Tarjan's strongly connected components algorithm
-    //
-    // https://en.wikipedia.org/wiki/Tarjan%27s_strongly_connected_components_algorithm
+    // Strongly connected components are computed on an interned copy,
+    // see csr_graph::sccs()
     reversed_.clear();
     ordered_.clear();
 
-    node_stack st;
-    int index = 0;
+    csr_graph cg;
 
-    reset();
-
-    for (auto& vp : nodes_) {
-        auto& v = vp.second;
+    for (const auto& p : nodes_) {
+        cg.add_node(p.first);
+    }
 
-        if (v.index == -1) {
-            order_func(v, reversed_, st, index);
+    for (const auto& p : nodes_) {
+        for (const auto& to : p.second.edges) {
+            cg.add_edge(p.first, to);
         }
     }
 
+    cg.build();
+
+    auto comps = cg.sccs();
+
+    reversed_.reserve(comps.nodes.size());
+
+    for (auto v : comps.nodes) {
+        reversed_.push_back(cg.name(v));
+    }
+
     ordered_.resize(reversed_.size());
 
     std::reverse_copy(
@@ -105,67 +112,4 @@ graph::is_tree() const
     return count == 1;
 }
 
-void
-graph::reset()
-{
-    for (auto& p : nodes_) {
-        p.second.reset();
-    }
-}
-
-void
-graph::order_func(
-    node& v,
-    strings& ordered,
-    node_stack& st,
-    int& index
-)
-{
-    // Set the depth index for v to the smallest unused index
-    v.index = index;
-    v.low_link = index;
-    ++index;
-
-    st.push_back(v);
-    v.on_stack = true;
-
-    // Consider successors of v
-    for (const auto& wn : v.edges) {
-        auto& w = nodes_.at(wn);
-
-        if (w.index == -1) {
-            // Successor w has not yet been visited; recurse on it
-            order_func(w, ordered, st, index);
-            v.low_link = std::min(v.low_link, w.low_link);
-        } else if (w.on_stack) {
-            // Successor w is in stack S and hence in the current SCC
-            // If w is not on stack, then (v, w) is a cross-edge
-            // in the DFS tree and must be ignored
-            // Note: The next line may look odd - but is correct.
-            // It says w.index not w.low_link; that is deliberate and
-            // from the original paper
-            v.low_link = std::min(v.low_link, w.index);
-        }
-    }
-
-    // If v is a root node, pop the stack and generate an SCC
-    if (v.low_link == v.index) {
-        // start a new strongly connected component
-        strings scc;
-
-        for ( ; ; ) {
-            node& w = st.back(); st.pop_back();
-
-            w.on_stack = false;
-            scc.push_back(w.name);
-
-            if (w.name == v.name) {
-                break;
-            }
-        }
-
-        ordered.insert(ordered.end(), scc.begin(), scc.end());
-    }
-}
-
 }
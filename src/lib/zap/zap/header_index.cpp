@@ -0,0 +1,77 @@
+#include <memory>
+#include <string_view>
+
+#include <zap/header_index.hpp>
+
+namespace zap {
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Header owner
+//
+///////////////////////////////////////////////////////////////////////////////
+bool
+header_owner::is_lib() const
+{ return type == header_owner_type::lib; }
+
+bool
+header_owner::is_pkg() const
+{ return type == header_owner_type::pkg; }
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Header index
+//
+///////////////////////////////////////////////////////////////////////////////
+header_index::header_index()
+{}
+
+header_index::~header_index()
+{}
+
+void
+header_index::clear()
+{ owners_.clear(); }
+
+std::size_t
+header_index::size() const
+{ return owners_.size(); }
+
+void
+header_index::add_lib(const target& t)
+{
+    owners_.reserve(owners_.size() + t.public_headers.size());
+
+    for (const auto& h : t.public_headers) {
+        // Project libraries shadow installed packages
+        owners_.insert_or_assign(
+            h,
+            header_owner{ header_owner_type::lib, t.name }
+        );
+    }
+}
+
+void
+header_index::add_pkg_file(const std::string& pkg, const std::string& file)
+{
+    static constexpr std::string_view inc_dir = "include/";
+
+    if (!file.starts_with(inc_dir)) {
+        return;
+    }
+
+    owners_.try_emplace(
+        file.substr(inc_dir.size()),
+        header_owner{ header_owner_type::pkg, pkg }
+    );
+}
+
+const header_owner*
+header_index::find(const std::string& header) const
+{
+    auto it = owners_.find(header);
+
+    return it == owners_.end() ? nullptr : std::addressof(it->second);
+}
+
+}
@@ -0,0 +1,169 @@
+#include <algorithm>
+
+#include <zap/link_reducer.hpp>
+#include <zap/utils.hpp>
+#include <zap/log.hpp>
+
+namespace zap {
+
+link_reducer::link_reducer(zap::project& p)
+: p_(p)
+{}
+
+link_reducer::~link_reducer()
+{}
+
+const link_reduction_stats&
+link_reducer::reduce()
+{
+    stats_ = {};
+
+    build_graph();
+    build_closures();
+
+    reduce(p_.libs);
+    reduce(p_.mods);
+    reduce(p_.bins);
+    reduce(p_.tsts);
+
+    return stats_;
+}
+
+const link_reduction_stats&
+link_reducer::stats() const
+{ return stats_; }
+
+void
+link_reducer::build_graph()
+{
+    g_.clear();
+
+    for (const auto& p : p_.libs) {
+        g_.add_node(p.first);
+    }
+
+    // Only public dependencies propagate to dependents
+    for (const auto& p : p_.libs) {
+        for (const auto& dep : p.second.public_deps.project_libs) {
+            if (g_.has_node(dep)) {
+                g_.add_edge(p.first, dep);
+            }
+        }
+    }
+
+    g_.build();
+}
+
+void
+link_reducer::build_closures()
+{
+    auto n = g_.size();
+    auto comps = g_.sccs();
+
+    acyclic_ = !g_.has_cycles();
+
+    if (!acyclic_) {
+        warn("cyclic library dependencies, skipping link reduction");
+    }
+
+    rank_.assign(n, 0);
+    reach_.assign(n, zap::bit_set(n));
+
+    // Dependencies come first so their closure is complete when reached
+    for (std::size_t i = 0; i < comps.nodes.size(); ++i) {
+        auto v = comps.nodes[i];
+
+        rank_[v] = i;
+
+        for (auto w : g_.edges(v)) {
+            reach_[v].set(w);
+            reach_[v] |= reach_[w];
+        }
+    }
+}
+
+void
+link_reducer::reduce(zap::targets& ts)
+{
+    for (auto& p : ts) {
+        reduce(p.second);
+    }
+}
+
+void
+link_reducer::reduce(zap::target& t)
+{
+    t.normalize_libs();
+
+    auto& pub = t.public_deps.project_libs;
+    auto& priv = t.private_deps.project_libs;
+
+    stats_.before += pub.size() + priv.size();
+
+    if (acyclic_) {
+        zap::bit_set pub_reach(g_.size());
+        zap::bit_set all_reach(g_.size());
+
+        add_reach(pub_reach, pub);
+        all_reach |= pub_reach;
+        add_reach(all_reach, priv);
+
+        reduce(pub, pub_reach);
+        reduce(priv, all_reach);
+    }
+
+    stats_.after += pub.size() + priv.size();
+
+    order(t.public_deps);
+    order(t.private_deps);
+}
+
+void
+link_reducer::reduce(
+    zap::string_set& libs,
+    const zap::bit_set& covered
+) const
+{
+    std::erase_if(
+        libs,
+        [&](const auto& lib) {
+            return g_.has_node(lib) && covered.test(g_.id(lib));
+        }
+    );
+}
+
+void
+link_reducer::add_reach(
+    zap::bit_set& reach,
+    const zap::string_set& libs
+) const
+{
+    for (const auto& lib : libs) {
+        if (g_.has_node(lib)) {
+            reach |= reach_[g_.id(lib)];
+        }
+    }
+}
+
+void
+link_reducer::order(zap::target_deps& deps) const
+{
+    auto& ol = deps.ordered_libs;
+
+    ol.assign(deps.project_libs.begin(), deps.project_libs.end());
+
+    auto rank = [&](const auto& lib) {
+        return g_.has_node(lib) ? rank_[g_.id(lib)] : 0;
+    };
+
+    // Most dependent first so static libraries link in the right order
+    std::stable_sort(
+        ol.begin(), ol.end(),
+        [&](const auto& a, const auto& b) { return rank(a) > rank(b); }
+    );
+
+    // External libraries come last as project libraries may need them
+    ol.insert(ol.end(), deps.libs.begin(), deps.libs.end());
+}
+
+}
@@ -0,0 +1,67 @@
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <zap/mapped_file.hpp>
+#include <zap/log.hpp>
+
+namespace zap {
+
+mapped_file::mapped_file(const std::string& path)
+{
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+
+    sysdie_if(fd == -1, "failed to open file: ", path);
+
+    struct stat st;
+
+    if (::fstat(fd, &st) == -1) {
+        ::close(fd);
+        sysdie("failed to stat file: ", path);
+    }
+
+    size_ = st.st_size;
+
+    if (size_ > 0) {
+        void* p = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+
+        if (p == MAP_FAILED) {
+            ::close(fd);
+            sysdie("failed to map file: ", path);
+        }
+
+        // Files are read front to back, mostly once
+        ::madvise(p, size_, MADV_SEQUENTIAL);
+
+        data_ = static_cast<const char*>(p);
+    }
+
+    // The mapping stays valid after close
+    ::close(fd);
+}
+
+mapped_file::~mapped_file()
+{
+    if (data_) {
+        ::munmap(const_cast<char*>(data_), size_);
+    }
+}
+
+const char*
+mapped_file::data() const
+{ return data_; }
+
+std::size_t
+mapped_file::size() const
+{ return size_; }
+
+bool
+mapped_file::empty() const
+{ return size_ == 0; }
+
+std::string_view
+mapped_file::view() const
+{ return { data_, size_ }; }
+
+}
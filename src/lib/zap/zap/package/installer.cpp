@@ -0,0 +1,331 @@
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <mutex>
+#include <unordered_set>
+
+#include <sys/ioctl.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <linux/fs.h>
+#endif
+
+#include <zap/package/installer.hpp>
+#include <zap/executor.hpp>
+#include <zap/utils.hpp>
+#include <zap/log.hpp>
+
+namespace zap::package {
+
+namespace fs = std::filesystem;
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Utilities
+//
+///////////////////////////////////////////////////////////////////////////////
+namespace detail {
+
+bool
+is_dir(const fs::directory_entry& e)
+{ return e.is_directory() && !e.is_symlink(); }
+
+// false when crossing filesystems
+bool
+move(const std::string& from, const std::string& to)
+{
+    if (::rename(from.c_str(), to.c_str()) == 0) {
+        return true;
+    }
+
+    sysdie_if(errno != EXDEV, "failed to move ", from, " to ", to);
+
+    return false;
+}
+
+bool
+clone(const std::string& from, const std::string& to)
+{
+    bool cloned = false;
+
+#ifdef FICLONE
+    int in = ::open(from.c_str(), O_RDONLY | O_CLOEXEC);
+
+    sysdie_if(in == -1, "failed to open ", from);
+
+    int out = ::open(
+        to.c_str(),
+        O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+        0600
+    );
+
+    if (out == -1) {
+        ::close(in);
+        sysdie("failed to create ", to);
+    }
+
+    cloned = ::ioctl(out, FICLONE, in) == 0;
+
+    ::close(out);
+    ::close(in);
+#endif
+
+    return cloned;
+}
+
+void
+copy(const std::string& from, const std::string& to)
+{
+    // Files in use by running builds are replaced, never rewritten
+    auto tmp = zap::cat(to, ".zap-tmp");
+    auto st = fs::symlink_status(from);
+
+    fs::remove(tmp);
+
+    if (fs::is_symlink(st)) {
+        fs::create_symlink(fs::read_symlink(from), tmp);
+    } else {
+        if (!clone(from, tmp)) {
+            fs::copy_file(from, tmp, fs::copy_options::overwrite_existing);
+        }
+
+        fs::permissions(tmp, st.permissions());
+    }
+
+    zap::rename(tmp, to);
+}
+
+std::string_view
+parent(std::string_view path)
+{
+    auto pos = path.rfind('/');
+
+    return
+        pos != std::string_view::npos
+        ? path.substr(0, pos)
+        : std::string_view{}
+        ;
+}
+
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Installer
+//
+///////////////////////////////////////////////////////////////////////////////
+installer::installer(const zap::env& e)
+: e_(e)
+{}
+
+installer::~installer()
+{}
+
+void
+installer::install(const std::string& stage_root, manifest& pm) const
+{
+    auto previous = e_.env_db().package_files(pm.name());
+
+    merge(stage_root, pm);
+
+    // Upgrades: what the new version doesn't install anymore
+    std::unordered_set<std::string_view> current(
+        pm.files().begin(),
+        pm.files().end()
+    );
+
+    strings stale;
+
+    for (const auto& pf : previous) {
+        if (!current.contains(pf.file)) {
+            stale.push_back(pf.file);
+        }
+    }
+
+    remove(stale);
+
+    e_.env_db().set_package(
+        env_db_pkg{ pm.name(), pm.version() },
+        pm.files()
+    );
+
+    zap::log(
+        pm.name(), " ", pm.version(), ": ",
+        pm.size(), " ", zap::plural("file", "s", pm.size()), " installed"
+    );
+}
+
+void
+installer::uninstall(const std::string& name) const
+{
+    env_db_pkg pkg;
+
+    die_unless(
+        e_.env_db().has_package(name, pkg),
+        "package ", name, " is not installed"
+    );
+
+    strings files;
+
+    for (auto& pf : e_.env_db().package_files(name)) {
+        files.emplace_back(std::move(pf.file));
+    }
+
+    remove(files);
+
+    e_.env_db().remove_package(name);
+
+    zap::log(
+        pkg.name, " ", pkg.version, ": ",
+        files.size(), " ", zap::plural("file", "s", files.size()),
+        " removed"
+    );
+}
+
+void
+installer::merge(const std::string& stage_root, manifest& pm) const
+{
+    if (!zap::directory_exists(stage_root)) {
+        zap::warn("nothing staged in ", stage_root);
+        return;
+    }
+
+    const auto& root = e_["root"];
+
+    // Directories not in the env yet are moved at once
+    strings dirs;
+    strings files;
+    strings copies;
+
+    auto relative = [&](const fs::path& p) {
+        return p.lexically_relative(stage_root).string();
+    };
+
+    using dir_iterator = fs::recursive_directory_iterator;
+
+    for (auto it = dir_iterator(stage_root); it != dir_iterator(); ++it) {
+        auto rel = relative(it->path());
+
+        if (!detail::is_dir(*it)) {
+            files.push_back(rel);
+            pm.add_file(rel);
+        } else if (!zap::exists(zap::cat_dir(root, rel))) {
+            it.disable_recursion_pending();
+            dirs.push_back(rel);
+
+            for (const auto& e : dir_iterator(it->path())) {
+                if (!detail::is_dir(e)) {
+                    pm.add_file(relative(e.path()));
+                }
+            }
+        }
+    }
+
+    // Parents of moved entries either existed or are the env root
+    zap::mkpath(root);
+
+    for (const auto& d : dirs) {
+        auto from = zap::cat_dir(stage_root, d);
+
+        if (detail::move(from, zap::cat_dir(root, d))) {
+            continue;
+        }
+
+        for (const auto& e : dir_iterator(from)) {
+            auto rel = relative(e.path());
+
+            if (detail::is_dir(e)) {
+                zap::mkpath(zap::cat_dir(root, rel));
+            } else {
+                copies.push_back(rel);
+            }
+        }
+
+        zap::mkpath(zap::cat_dir(root, d));
+    }
+
+    for (const auto& f : files) {
+        auto from = zap::cat_file(stage_root, f);
+
+        if (!detail::move(from, zap::cat_file(root, f))) {
+            copies.push_back(f);
+        }
+    }
+
+    copy(copies, stage_root);
+}
+
+void
+installer::copy(const strings& files, const std::string& stage_root) const
+{
+    if (files.empty()) {
+        return;
+    }
+
+    std::mutex m;
+    std::string error;
+
+    auto cb = [&](auto, const auto& file) {
+        try {
+            detail::copy(
+                zap::cat_file(stage_root, file),
+                zap::cat_file(e_["root"], file)
+            );
+        } catch (const std::exception& ex) {
+            std::lock_guard<std::mutex> l(m);
+
+            if (error.empty()) {
+                error = ex.what();
+            }
+        }
+    };
+
+    {
+        zap::async_pool<decltype(cb)> ap(e_.executor(), cb);
+
+        for (const auto& file : files) {
+            ap.async(file);
+        }
+
+        ap.wait();
+    }
+
+    die_unless(error.empty(), "failed to install files: ", error);
+}
+
+void
+installer::remove(const strings& files) const
+{
+    const auto& root = e_["root"];
+
+    // Top-level env directories are kept
+    zap::string_set parents;
+
+    for (const auto& f : files) {
+        auto path = zap::cat_file(root, f);
+
+        if (::unlink(path.c_str()) == -1 && errno != ENOENT) {
+            zap::warn("failed to remove ", path, ": ", std::strerror(errno));
+        }
+
+        auto d = detail::parent(f);
+
+        while (
+            d.find('/') != std::string_view::npos
+            &&
+            parents.emplace(d).second
+        ) {
+            d = detail::parent(d);
+        }
+    }
+
+    // Reverse order has subdirectories before their parents
+    for (const auto& d : zap::reverse(parents)) {
+        // Fails as expected on directories still in use
+        ::rmdir(zap::cat_dir(root, d).c_str());
+    }
+}
+
+}
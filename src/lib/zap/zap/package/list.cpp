@@ -0,0 +1,78 @@
+#include <fstream>
+#include <sstream>
+
+#include <zap/package/list.hpp>
+#include <zap/digest.hpp>
+#include <zap/utils.hpp>
+#include <zap/log.hpp>
+
+namespace zap::package {
+
+list
+load_list(const std::string& file)
+{
+    std::ifstream ifs(file);
+
+    die_if(!ifs, "failed to open package list: ", file);
+
+    list l;
+
+    for (std::string line; std::getline(ifs, line); ) {
+        std::istringstream iss(line);
+        list_entry le;
+
+        if (!(iss >> le.url) || le.url.starts_with('#')) {
+            continue;
+        }
+
+        for (std::string arg; iss >> arg; ) {
+            if (le.args.empty() && le.digest.empty() && valid_digest(arg)) {
+                le.digest = std::move(arg);
+            } else {
+                le.args.emplace_back(std::move(arg));
+            }
+        }
+
+        l.emplace_back(std::move(le));
+    }
+
+    return l;
+}
+
+strings
+list_urls(const list& l)
+{
+    string_set seen;
+    strings urls;
+
+    for (const auto& le : l) {
+        if (seen.insert(le.url).second) {
+            urls.push_back(le.url);
+        }
+    }
+
+    return urls;
+}
+
+string_map
+list_digests(const list& l)
+{
+    string_map digests;
+
+    for (const auto& le : l) {
+        if (le.digest.empty()) {
+            continue;
+        }
+
+        auto [ it, inserted ] = digests.try_emplace(le.url, le.digest);
+
+        die_unless(
+            inserted || it->second == le.digest,
+            "conflicting digests for ", le.url
+        );
+    }
+
+    return digests;
+}
+
+}
@@ -5,7 +5,43 @@ namespace zap::package {
 manifest::manifest()
 {}
 
+manifest::manifest(const std::string& name, const std::string& version)
+: name_(name),
+version_(version)
+{}
+
 manifest::~manifest()
 {}
 
+const std::string&
+manifest::name() const
+{ return name_; }
+
+const std::string&
+manifest::version() const
+{ return version_; }
+
+void
+manifest::set_package(const std::string& name, const std::string& version)
+{
+    name_ = name;
+    version_ = version;
+}
+
+void
+manifest::add_file(const std::string& file)
+{ files_.push_back(file); }
+
+const strings&
+manifest::files() const
+{ return files_; }
+
+bool
+manifest::empty() const
+{ return files_.empty(); }
+
+std::size_t
+manifest::size() const
+{ return files_.size(); }
+
 }
@@ -0,0 +1,79 @@
+#include <algorithm>
+
+#include <zap/prefetcher.hpp>
+#include <zap/utils.hpp>
+#include <zap/log.hpp>
+
+namespace zap {
+
+prefetcher::prefetcher(
+    const zap::env& e,
+    const strings& urls,
+    std::size_t jobs,
+    bool fetch_only,
+    const string_map& digests
+)
+: e_(e),
+urls_(urls),
+fetch_only_(fetch_only),
+digests_(digests),
+promises_(urls.size())
+{
+    for (std::size_t i = 0; i < urls_.size(); ++i) {
+        index_.try_emplace(urls_[i], i);
+        futures_.emplace_back(promises_[i].get_future().share());
+    }
+
+    jobs = std::clamp<std::size_t>(jobs, 1, std::max<std::size_t>(
+        urls_.size(), 1
+    ));
+
+    for (std::size_t i = 0; i < jobs; ++i) {
+        workers_.emplace_back([this] { run(); });
+    }
+}
+
+prefetcher::~prefetcher()
+{
+    next_ = urls_.size();
+
+    for (auto& w : workers_) {
+        w.join();
+    }
+}
+
+archive_info
+prefetcher::get(const std::string& url) const
+{
+    auto it = index_.find(url);
+
+    die_if(it == index_.end(), "archive not prefetched: ", url);
+
+    return futures_[it->second].get();
+}
+
+void
+prefetcher::run()
+{
+    for (auto i = next_++; i < urls_.size(); i = next_++) {
+        const auto& url = urls_[i];
+        auto it = digests_.find(url);
+        const auto& digest =
+            it != digests_.end()
+            ? it->second
+            : std::string{}
+            ;
+
+        try {
+            promises_[i].set_value(
+                fetch_only_
+                ? e_.fetch_archive(url, digest)
+                : e_.download_archive(url, digest)
+            );
+        } catch (...) {
+            promises_[i].set_exception(std::current_exception());
+        }
+    }
+}
+
+}
@@ -6,6 +6,12 @@ namespace zap {
 
 void
 project::add_target(targets& ts, const std::string& tname, target& t)
-{ ts.try_emplace(tname, std::move(t)); }
+{
+    auto [ it, inserted ] = ts.try_emplace(tname, std::move(t));
+
+    if (inserted && it->second.is_lib()) {
+        headers.add_lib(it->second);
+    }
+}
 
 }
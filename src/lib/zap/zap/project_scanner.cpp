@@ -0,0 +1,129 @@
+#include <zap/project_scanner.hpp>
+#include <zap/layout.hpp>
+#include <zap/utils.hpp>
+#include <zap/log.hpp>
+
+namespace zap {
+
+project_scanner::project_scanner(const zap::env& e, zap::project& p)
+: e_(e),
+p_(p)
+{}
+
+project_scanner::~project_scanner()
+{}
+
+void
+project_scanner::find_targets(const std::string& root_dir)
+{
+    p_.root_dir = root_dir;
+
+    auto& layout = zap::get_layout(p_.root_dir);
+
+    layout.find_targets(p_);
+}
+
+void
+project_scanner::scan_targets()
+{
+    scan_targets(p_.libs);
+    scan_targets(p_.mods);
+    scan_targets(p_.bins);
+    scan_targets(p_.tsts);
+}
+
+void
+project_scanner::scan_targets(zap::targets& ts)
+{
+    // Files of a target are scanned in parallel by the toolchain
+    for (auto& p : ts) {
+        scan_target(p.second);
+    }
+}
+
+void
+project_scanner::scan_target(zap::target& t)
+{
+    zap::log("scanning ", t.type, " ", t.name);
+    scan_target_files(t, t.inc_dir, t.public_headers, t.public_deps);
+    scan_target_files(t, t.src_dir, t.private_headers, t.private_deps);
+    scan_target_files(t, t.src_dir, t.sources, t.private_deps);
+}
+
+void
+project_scanner::scan_target_files(
+    zap::target& t,
+    const std::string& dir,
+    const zap::files& files,
+    zap::target_deps& deps
+)
+{
+    zap::scan_context ctx;
+    const auto& tc = e_.toolchain();
+
+    tc.scan_files(p_.inc_dirs, dir, files, ctx);
+
+    for (auto& dep : ctx.deps) {
+        if (tc.is_std_header(dep) || t.has_file(dep)) {
+            continue;
+        }
+
+        const auto* owner = find_owner(t, dep);
+
+        if (owner && owner->is_lib()) {
+            deps.project_libs.insert(owner->name);
+        } else {
+            if (owner) {
+                t.pkg_deps.insert(owner->name);
+            }
+
+            deps.headers.insert(dep);
+        }
+    }
+
+    for (auto& fd : ctx.file_deps) {
+        t.file_deps.insert_or_assign(
+            zap::cat_file(dir, fd.first),
+            std::move(fd.second)
+        );
+    }
+}
+
+const zap::header_owner*
+project_scanner::find_owner(const target& t, const std::string& dep)
+{
+    const auto* owner = p_.headers.find(dep);
+
+    if (!owner) {
+        owner = find_pkg_owner(dep);
+    }
+
+    if (owner && owner->is_lib() && t.is_lib() && owner->name == t.name) {
+        // That's me
+        return nullptr;
+    }
+
+    return owner;
+}
+
+const zap::header_owner*
+project_scanner::find_pkg_owner(const std::string& dep)
+{
+    // Found ones are added to the project header index
+    if (!env_lookups_.insert(dep).second) {
+        return nullptr;
+    }
+
+    auto file = zap::cat_file("include", dep);
+    std::string pkg;
+
+    if (!e_.env_db().file_owner(file, pkg)) {
+        return nullptr;
+    }
+
+    p_.headers.add_pkg_file(pkg, file);
+
+    return p_.headers.find(dep);
+}
+
+}
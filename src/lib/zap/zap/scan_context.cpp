@@ -4,6 +4,9 @@ namespace zap {
 
 void
 scan_context::merge(scan_context& other)
-{ deps.merge(other.deps); }
+{
+    deps.merge(other.deps);
+    file_deps.merge(other.file_deps);
+}
 
 }
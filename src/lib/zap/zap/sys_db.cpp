@@ -9,6 +9,9 @@ namespace zap {
 
 struct sys_db_spec
 {
+    // Bumped on schema changes
+    static constexpr int version = 1;
+
     static auto make(const std::string& file)
     {
         using namespace sqlite_orm;
@@ -59,8 +62,7 @@ sys_db::sys_db()
 
     db_ptr_ = dbi::new_storage(db_file);
 
-    db().open_forever();
-    db().sync_schema();
+    dbi().open();
 
     load_info();
 
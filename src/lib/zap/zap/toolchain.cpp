@@ -199,6 +199,23 @@ toolchain::scan_files(
     const files& f,
     strings& deps
 ) const
+{
+    scan_context ctx;
+
+    scan_files(inc_dirs, dir, f, ctx);
+
+    for (auto&& d : ctx.deps) {
+        deps.emplace_back(std::move(d));
+    }
+}
+
+void
+toolchain::scan_files(
+    const strings& inc_dirs,
+    const std::string& dir,
+    const files& f,
+    scan_context& ctx
+) const
 {}
 
 strings
@@ -243,6 +260,26 @@ const std::string&
 toolchain::name() const
 { return toolchain_name(info_.type); }
 
+std::string
+toolchain::fingerprint() const
+{
+    auto key = cat(name(), ':', info_.version, ':', target_arch_);
+
+    for (const auto* p : { &cc(), &cxx() }) {
+        // Upgrades in place keep the same path
+        key += cat(':', p->cmd, ':', file_mtime(p->cmd));
+    }
+
+    char buf[16 + 1];
+
+    std::snprintf(
+        buf, sizeof(buf),
+        "%016zx", std::hash<std::string>{}(key)
+    );
+
+    return buf;
+}
+
 prog&
 toolchain::cxx()
 { return info_.cxx; }
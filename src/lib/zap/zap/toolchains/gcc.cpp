@@ -48,7 +48,7 @@ gcc::scan_files(
     const zap::strings& inc_dirs,
     const std::string& dir,
     const zap::files& f,
-    zap::strings& deps
+    zap::scan_context& ctx
 ) const
 {
     if (f.empty()) {
@@ -68,12 +68,15 @@ gcc::scan_files(
     auto header_pat = "(?:" + zap::join("|", slash_inc_dirs) + ")?(\\S+)";
     re2::RE2 header_re(header_pat);
 
-    auto cb = [&](auto& ctx, const auto& dir, const auto& file) {
+    auto cb = [&](auto& wctx, const auto& dir, const auto& file) {
         auto res = sc.run_silent_no_fail(
             { .args = { zap::cat_file(dir, file) } }
         );
 
-        extract_deps(header_re, res, ctx.deps);
+        auto& fdeps = wctx.file_deps[file];
+
+        extract_deps(header_re, res, fdeps);
+        wctx.deps.insert(fdeps.begin(), fdeps.end());
     };
 
     zap::async_pool<decltype(cb), zap::scan_context> ap(executor(), cb);
@@ -82,11 +85,7 @@ gcc::scan_files(
         ap.async(dir, file);
     }
 
-    auto& merged = ap.wait();
-
-    for (auto&& d : merged.deps) {
-        deps.emplace_back(std::move(d));
-    }
+    ctx.merge(ap.wait());
 }
 
 zap::strings
@@ -9,7 +9,7 @@ namespace zap {
 static const re2::RE2 url_re(
     "(?:(\\w+)://)"            // scheme
     "(?:(\\w+)\\:(\\w+)@)?"    // user:password@
-    "([^/:]+)"                 // hostname
+    "([^/:]*)"                 // hostname, empty for file:///path
     "(?:\\:(\\d*))?"           // port
     "(.*)"                     // uri
 );
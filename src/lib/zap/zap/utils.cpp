@@ -671,6 +671,24 @@ dir_is_empty(const std::string_view& path)
     return !has_dirs(path) && !has_files(path);
 }
 
+std::size_t
+dir_size(const std::string_view& path)
+{
+    namespace fs = std::filesystem;
+
+    std::size_t size = 0;
+
+    if (directory_exists(path)) {
+        for (const auto& p : fs::recursive_directory_iterator(path)) {
+            if (p.is_regular_file() && !p.is_symlink()) {
+                size += p.file_size();
+            }
+        }
+    }
+
+    return size;
+}
+
 std::string
 empty_temp_dir(const std::string_view& base_dir)
 {
@@ -797,6 +815,41 @@ human_readable_rate(
     return oss.str();
 }
 
+std::string
+human_readable_duration(std::size_t millisecs)
+{
+    char buf[50 + 1];
+
+    if (millisecs < 1000) {
+        std::snprintf(buf, sizeof(buf), "%zums", millisecs);
+    } else if (millisecs < 60 * 1000) {
+        std::snprintf(buf, sizeof(buf), "%.2fs", millisecs / 1000.0);
+    } else {
+        auto secs = millisecs / 1000;
+        auto mins = secs / 60;
+
+        if (mins < 60) {
+            std::snprintf(buf, sizeof(buf), "%zum%02zus", mins, secs % 60);
+        } else {
+            std::snprintf(buf, sizeof(buf), "%zuh%02zum", mins / 60, mins % 60);
+        }
+    }
+
+    return buf;
+}
+
+std::size_t
+timed(const std::function<void()>& cb)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    cb();
+
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start
+    ).count();
+}
+
 std::string
 plural(
     const std::string& base,
@@ -61,6 +61,14 @@ zapfile::load_deps(
             load_strings(opts, "configure", d.opts);
             load_strings(opts, "build", d.opts);
             load_strings(opts, "install", d.opts);
+
+            if (opts["digest"]) {
+                d.digest = opts["digest"].as<std::string>();
+            }
+
+            if (opts["requires"]) {
+                d.needs = opts["requires"].as<strings>();
+            }
         } else {
             die("dependency is not a scalar or map: ", dep);
         }
@@ -70,6 +78,8 @@ zapfile::load_deps(
         } else {
             die("invalid dependency: ", s);
         }
+
+        deps.emplace_back(std::move(d));
     }
 }
 
@@ -81,7 +91,18 @@ zapfile::set_remote(
     const std::string& version,
     dependency& d
 )
-{}
+{
+    die_if(version.empty(), "missing version of dependency: ", spec);
+
+    // Defaults to the GitHub remote created with the system database
+    set_remote_repository(
+        remotes,
+        id.empty() ? "GH" : id,
+        spec,
+        version,
+        d
+    );
+}
 
 void
 zapfile::set_remote_repository(
@@ -92,12 +113,12 @@ zapfile::set_remote_repository(
     dependency& d
 )
 {
-    url u;
-
     die_unless(remotes.contains(id), "unknown remote: ", id);
 
     const auto& r = remotes.at(id);
-    auto t = to_repository(r.type);
+
+    d.type = to_repository(r.type);
+    d.r = to_remote(d.type, r.url, spec, version);
 }
 
 void
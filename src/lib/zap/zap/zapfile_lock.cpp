@@ -0,0 +1,156 @@
+#include <fstream>
+#include <unordered_map>
+
+#include <yaml-cpp/yaml.h>
+
+#include <zap/zapfile_lock.hpp>
+#include <zap/digest.hpp>
+#include <zap/utils.hpp>
+#include <zap/log.hpp>
+
+namespace zap {
+
+static const strings lock_opts = { "configure", "build", "install" };
+
+std::string
+zapfile_lock::file_of(const std::string& zapfile)
+{ return cat(zapfile, ".lock"); }
+
+bool
+zapfile_lock::load(const std::string& file, const std::string& zapfile)
+{
+    if (!file_exists(file) || !file_exists(zapfile)) {
+        return false;
+    }
+
+    YAML::Node c = YAML::LoadFile(file);
+
+    this->zapfile = c["zapfile"] ? c["zapfile"].as<std::string>() : "";
+    deps.clear();
+
+    if (c["depends"]) {
+        die_unless(c["depends"].IsSequence(), "depends is not a sequence");
+
+        for (const auto& n : c["depends"]) {
+            locked_dependency d{
+                .name = n["name"].as<std::string>(),
+                .url = n["url"].as<std::string>()
+            };
+
+            if (n["digest"]) {
+                d.digest = n["digest"].as<std::string>();
+            }
+
+            if (n["build"]) {
+                d.build = n["build"].as<std::string>();
+            }
+
+            for (const auto& key : lock_opts) {
+                if (n[key]) {
+                    d.opts[key] = n[key].as<strings>();
+                }
+            }
+
+            if (n["requires"]) {
+                d.needs = n["requires"].as<strings>();
+            }
+
+            deps.emplace_back(std::move(d));
+        }
+    }
+
+    return this->zapfile == digest_file("sha256", zapfile);
+}
+
+void
+zapfile_lock::save(const std::string& file) const
+{
+    YAML::Node c;
+
+    c["zapfile"] = zapfile;
+    c["depends"] = YAML::Node(YAML::NodeType::Sequence);
+
+    for (const auto& d : deps) {
+        YAML::Node n;
+
+        n["name"] = d.name;
+        n["url"] = d.url;
+
+        if (!d.digest.empty()) {
+            n["digest"] = d.digest;
+        }
+
+        if (!d.build.empty()) {
+            n["build"] = d.build;
+        }
+
+        for (const auto& key : lock_opts) {
+            auto it = d.opts.find(key);
+
+            if (it != d.opts.end()) {
+                n[key] = it->second;
+            }
+        }
+
+        if (!d.needs.empty()) {
+            n["requires"] = d.needs;
+        }
+
+        c["depends"].push_back(n);
+    }
+
+    // Readers never see a partial lock
+    auto tmp = cat(file, ".zap-tmp");
+
+    {
+        std::ofstream ofs(tmp, std::ios::trunc);
+
+        die_if(!ofs, "failed to write ", tmp);
+
+        ofs
+            << "# Generated by zap from the Zapfile, do not edit\n"
+            << c << "\n"
+            ;
+    }
+
+    rename(tmp, file);
+}
+
+void
+zapfile_lock::resolve(const std::string& file, const zap::zapfile& zf)
+{
+    std::unordered_map<std::string, locked_dependency> locked;
+
+    for (auto& d : deps) {
+        auto url = d.url;
+
+        locked.try_emplace(std::move(url), std::move(d));
+    }
+
+    zapfile = digest_file("sha256", file);
+    deps.clear();
+
+    for (const auto& d : zf.deps) {
+        locked_dependency ld{
+            .name = remote_name(d.r),
+            .url = remote_to_string(d.r),
+            .digest = d.digest,
+            .opts = d.opts,
+            .needs = d.needs
+        };
+
+        auto it = locked.find(ld.url);
+
+        if (it != locked.end()) {
+            if (ld.digest.empty()) {
+                ld.digest = it->second.digest;
+            }
+
+            ld.build = it->second.build;
+        }
+
+        deps.emplace_back(std::move(ld));
+    }
+}
+
+}